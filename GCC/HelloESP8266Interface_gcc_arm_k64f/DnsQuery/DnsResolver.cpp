@@ -0,0 +1,271 @@
+/* DnsResolver
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef __unix__
+//Also built on the host with PosixNetworkInterface
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#else
+#include "mbed.h"
+#include "us_ticker_api.h"
+#endif
+#include "DnsResolver.h"
+
+//Answers are not trusted for longer than a day
+#define DNS_MAX_TTL 86400
+
+//Free running microsecond clock, differences stay right across a wrap
+static uint32_t clock_us(void)
+{
+#ifdef __unix__
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_usec);
+#else
+    return us_ticker_read();
+#endif
+}
+
+DnsResolver::DnsResolver(NetworkInterface &iface) : _iface(iface)
+{
+    static const char *defaultServers[] = {
+        "8.8.8.8",
+        "209.244.0.3",
+        "84.200.69.80",
+        "8.26.56.26",
+        "208.67.222.222"
+    };
+    _serverCount = 0;
+    setServers(defaultServers, 5);
+    _useCounter = 0;
+    flushCache();
+}
+
+bool DnsResolver::setServers(const char *const *servers, int count)
+{
+    if (count <= 0 || count > DNS_RESOLVER_MAX_SERVERS) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (strlen(servers[i]) >= sizeof(_servers[i])) {
+            return false;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        strcpy(_servers[i], servers[i]);
+    }
+    _serverCount = count;
+    return true;
+}
+
+void DnsResolver::flushCache(void)
+{
+    for (int i = 0; i < DNS_RESOLVER_CACHE_SIZE; i++) {
+        _cache[i].name[0] = 0;
+    }
+}
+
+//The first IPv4 address of a list as a string
+static bool firstIPv4(const dns_addr_t *addrs, int count, char *ipaddress)
+{
+    for (int i = 0; i < count; i++) {
+        if (addrs[i].version == 4) {
+            DnsQuery::addressToString(&addrs[i], ipaddress);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DnsResolver::getHostByName(const char *hostname, char *ipaddress, uint32_t timeout_ms)
+{
+    dns_addr_t addrs[DNS_RESOLVER_MAX_ADDRS];
+    int found = getHostByName(hostname, addrs, DNS_RESOLVER_MAX_ADDRS, timeout_ms);
+    return firstIPv4(addrs, found, ipaddress);
+}
+
+int DnsResolver::getHostByName(const char *hostname, dns_addr_t *addrs, int count, uint32_t timeout_ms)
+{
+    if (hostname == NULL || count <= 0) {
+        return 0;
+    }
+    int found = lookup(hostname, addrs, count);
+    if (found > 0) {
+        return found;
+    }
+
+    //Query the servers a group at a time, sharing the time left between the groups
+    dns_addr_t answer[DNS_RESOLVER_MAX_ADDRS];
+    uint32_t start = clock_us();
+    for (int first = 0; first < _serverCount; first += DNS_RESOLVER_MAX_PARALLEL) {
+        int servers = _serverCount - first;
+        if (servers > DNS_RESOLVER_MAX_PARALLEL) {
+            servers = DNS_RESOLVER_MAX_PARALLEL;
+        }
+        int groups = (_serverCount - first + DNS_RESOLVER_MAX_PARALLEL - 1) / DNS_RESOLVER_MAX_PARALLEL;
+        int left = (int)timeout_ms - (int)((clock_us() - start) / 1000);
+        if (left <= 0) {
+            break;
+        }
+        found = query(first, servers, hostname, answer, DNS_RESOLVER_MAX_ADDRS, left / groups);
+        if (found > 0) {
+            store(hostname, answer, found);
+            if (found > count) {
+                found = count;
+            }
+            memcpy(addrs, answer, found * sizeof(dns_addr_t));
+            return found;
+        }
+    }
+    return 0;
+}
+
+bool DnsResolver::lookup(const char *hostname, char *ipaddress)
+{
+    dns_addr_t addrs[DNS_RESOLVER_MAX_ADDRS];
+    int found = lookup(hostname, addrs, DNS_RESOLVER_MAX_ADDRS);
+    return firstIPv4(addrs, found, ipaddress);
+}
+
+int DnsResolver::lookup(const char *hostname, dns_addr_t *addrs, int count)
+{
+    time_t now = time(NULL);
+    for (int i = 0; i < DNS_RESOLVER_CACHE_SIZE; i++) {
+        CacheEntry &entry = _cache[i];
+        if (entry.name[0] == 0 || strcmp(entry.name, hostname) != 0) {
+            continue;
+        }
+        if (now >= entry.expires) {
+            entry.name[0] = 0;
+            return 0;
+        }
+        entry.lastUsed = ++_useCounter;
+        int found = (entry.count < count) ? entry.count : count;
+        memcpy(addrs, entry.addrs, found * sizeof(dns_addr_t));
+        return found;
+    }
+    return 0;
+}
+
+void DnsResolver::store(const char *hostname, const char *ipaddress, uint32_t ttl)
+{
+    unsigned int a, b, c, d;
+    char end;
+    if (sscanf(ipaddress, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 ||
+        a > 255 || b > 255 || c > 255 || d > 255) {
+        return;
+    }
+    dns_addr_t addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.version = 4;
+    addr.addr[0] = a;
+    addr.addr[1] = b;
+    addr.addr[2] = c;
+    addr.addr[3] = d;
+    addr.ttl = ttl;
+    store(hostname, &addr, 1);
+}
+
+void DnsResolver::store(const char *hostname, const dns_addr_t *addrs, int count)
+{
+    if (count <= 0 || strlen(hostname) >= DNS_RESOLVER_MAX_NAME) {
+        return;
+    }
+    if (count > DNS_RESOLVER_MAX_ADDRS) {
+        count = DNS_RESOLVER_MAX_ADDRS;
+    }
+    //The set is kept as long as its shortest lived address
+    uint32_t ttl = DNS_MAX_TTL;
+    for (int i = 0; i < count; i++) {
+        if (addrs[i].ttl < ttl) {
+            ttl = addrs[i].ttl;
+        }
+    }
+    if (ttl == 0) {
+        return;
+    }
+    //Take a free entry, or else the least recently used one
+    int victim = 0;
+    for (int i = 0; i < DNS_RESOLVER_CACHE_SIZE; i++) {
+        if (_cache[i].name[0] == 0) {
+            victim = i;
+            break;
+        }
+        if (_cache[i].lastUsed < _cache[victim].lastUsed) {
+            victim = i;
+        }
+    }
+    CacheEntry &entry = _cache[victim];
+    strcpy(entry.name, hostname);
+    memcpy(entry.addrs, addrs, count * sizeof(dns_addr_t));
+    entry.count = count;
+    entry.expires = time(NULL) + ttl;
+    entry.lastUsed = ++_useCounter;
+}
+
+int DnsResolver::query(int first, int count, const char *hostname, dns_addr_t *addrs, int size, uint32_t timeout_ms)
+{
+    uint8_t packet[DNS_MAX_PACKET];
+    uint16_t ids[DNS_RESOLVER_MAX_PARALLEL];
+    bool asked[DNS_RESOLVER_MAX_PARALLEL];
+    int waiting = 0;
+
+    //One socket sends the question to every server of the group before waiting for any answer
+    SocketInterface *sock = _iface.allocateSocket(SOCK_UDP);
+    if (sock == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        ids[i] = DnsQuery::randomID();
+        int len = DnsQuery::buildQuery(packet, sizeof(packet), ids[i], hostname);
+        asked[i] = (len >= 0) && (sock->sendTo(_servers[first + i], DNS_RESOLVER_PORT, packet, len) >= 0);
+        if (asked[i]) {
+            waiting++;
+        }
+    }
+
+    //The first answer with an address wins, a server that fails is not waited for any more
+    int found = 0;
+    uint32_t start = clock_us();
+    while (found <= 0 && waiting > 0) {
+        int left = (int)timeout_ms - (int)((clock_us() - start) / 1000);
+        if (left <= 0) {
+            break;
+        }
+        char from[16];
+        uint16_t port;
+        int len = sock->recvFrom(from, &port, packet, sizeof(packet), left);
+        if (len <= 0) {
+            break;
+        }
+        //Without the sender the ID alone tells the servers apart
+        for (int i = 0; i < count && found <= 0; i++) {
+            if (!asked[i] || (from[0] && strcmp(from, _servers[first + i]) != 0)) {
+                continue;
+            }
+            if (len < 2 || ((packet[0] << 8) | packet[1]) != ids[i]) {
+                continue;
+            }
+            found = DnsQuery::parseAnswers(packet, len, ids[i], addrs, size);
+            asked[i] = false;
+            waiting--;
+        }
+    }
+
+    sock->close();
+    _iface.deallocateSocket(sock);
+    return (found > 0) ? found : 0;
+}
@@ -0,0 +1,138 @@
+/* DnsResolver
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __DNSRESOLVER_H__
+#define __DNSRESOLVER_H__
+
+#include "NetworkInterface.h"
+#include "DnsQuery.h"
+#include <time.h>
+
+#ifndef DNS_RESOLVER_CACHE_SIZE
+#define DNS_RESOLVER_CACHE_SIZE 8
+#endif
+
+#ifndef DNS_RESOLVER_MAX_SERVERS
+#define DNS_RESOLVER_MAX_SERVERS 5
+#endif
+
+/* Servers queried at the same time, each query takes a socket */
+#ifndef DNS_RESOLVER_MAX_PARALLEL
+#define DNS_RESOLVER_MAX_PARALLEL 3
+#endif
+
+/* Port the servers answer on, another one lets a host test run its own server */
+#ifndef DNS_RESOLVER_PORT
+#define DNS_RESOLVER_PORT 53
+#endif
+
+/* Longest hostname kept in the cache, longer names are always queried */
+#ifndef DNS_RESOLVER_MAX_NAME
+#define DNS_RESOLVER_MAX_NAME 64
+#endif
+
+/* Addresses kept for each cached hostname */
+#ifndef DNS_RESOLVER_MAX_ADDRS
+#define DNS_RESOLVER_MAX_ADDRS 4
+#endif
+
+/** DnsResolver class.
+    Resolves hostnames over the UDP sockets of a NetworkInterface. Several
+    servers are queried at once and the first answer wins. Every address of
+    an answer is kept in a small LRU cache until the shortest TTL runs out.
+ */
+class DnsResolver
+{
+public:
+    /** Constructor to instantiate a DnsResolver object.
+      * @param iface : The interface whose sockets carry the queries
+      */
+    DnsResolver(NetworkInterface &iface);
+
+    /** Replace the list of DNS servers, tried in the given order.
+      * @param servers : IP addresses of the servers as strings
+      * @param count : number of entries in servers, at most DNS_RESOLVER_MAX_SERVERS
+      * @returns true if successful, or false if the list was left unchanged.
+      */
+    bool setServers(const char *const *servers, int count);
+
+    /** Resolve a hostname, from the cache when possible.
+      * @param hostname : the hostname of interest as a string, IE google.com, mbed.org, etc
+      * @param ipaddress : receives the IP address as a string, 16 bytes
+      * @param timeout_ms : longest time to wait for an answer from all servers together
+      * @returns true if successful, or false otherwise.
+      */
+    bool getHostByName(const char *hostname, char *ipaddress, uint32_t timeout_ms = 15000);
+
+    /** Resolve a hostname to all of its addresses, from the cache when possible.
+      * @param hostname : the hostname of interest as a string
+      * @param addrs : receives the addresses in the order of the answer
+      * @param count : the number of entries in addrs
+      * @param timeout_ms : longest time to wait for an answer from all servers together
+      * @returns the number of addresses stored, or 0 if the name was not resolved.
+      */
+    int getHostByName(const char *hostname, dns_addr_t *addrs, int count, uint32_t timeout_ms = 15000);
+
+    /** Forget every cached answer */
+    void flushCache(void);
+
+    /** Look up a hostname in the cache only.
+      * @param hostname : the hostname of interest as a string
+      * @param ipaddress : receives the IP address as a string, 16 bytes
+      * @returns true if the cache holds an unexpired answer, or false otherwise.
+      */
+    bool lookup(const char *hostname, char *ipaddress);
+
+    /** Look up all addresses of a hostname in the cache only.
+      * @param hostname : the hostname of interest as a string
+      * @param addrs : receives the cached addresses
+      * @param count : the number of entries in addrs
+      * @returns the number of addresses stored, or 0 if the cache holds no unexpired answer.
+      */
+    int lookup(const char *hostname, dns_addr_t *addrs, int count);
+
+    /** Add an answer found by other means to the cache.
+      * @param hostname : the hostname as a string
+      * @param ipaddress : its IP address as a string
+      * @param ttl : seconds the answer may be used for
+      */
+    void store(const char *hostname, const char *ipaddress, uint32_t ttl);
+
+    /** Add the addresses of an answer found by other means to the cache.
+      * @param hostname : the hostname as a string
+      * @param addrs : its addresses, the shortest ttl decides how long they are kept
+      * @param count : the number of entries in addrs, up to DNS_RESOLVER_MAX_ADDRS are kept
+      */
+    void store(const char *hostname, const dns_addr_t *addrs, int count);
+
+private:
+    struct CacheEntry {
+        char name[DNS_RESOLVER_MAX_NAME];
+        dns_addr_t addrs[DNS_RESOLVER_MAX_ADDRS];
+        int count;
+        time_t expires;
+        uint32_t lastUsed;
+    };
+
+    int query(int first, int count, const char *hostname, dns_addr_t *addrs, int size, uint32_t timeout_ms);
+
+    NetworkInterface &_iface;
+    char _servers[DNS_RESOLVER_MAX_SERVERS][16];
+    int _serverCount;
+    CacheEntry _cache[DNS_RESOLVER_CACHE_SIZE];
+    uint32_t _useCounter;
+};
+
+#endif // __DNSRESOLVER_H__
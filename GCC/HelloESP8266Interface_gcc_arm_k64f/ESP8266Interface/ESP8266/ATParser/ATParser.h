@@ -22,6 +22,9 @@
 #include <cstdarg>
 #include "BufferedSerial.h"
 
+#ifndef ATPARSER_MAX_OOBS
+#define ATPARSER_MAX_OOBS 24
+#endif
 
 /**
 * Parser class for parsing AT commands
@@ -38,6 +41,8 @@
 * at.recv("+IPD,%d:", &value);
 * at.read(buffer, value);
 * at.recv("OK");
+* at.oob("+IPD,", &handler, &Handler::packet);
+* at.process();
 * @endcode
 */
 class ATParser
@@ -54,6 +59,16 @@ private:
     int _delim_size;
     uint8_t at_echo;
 
+    // Out-of-band handlers
+    struct oob {
+        const char *prefix;
+        int len;
+        FunctionPointerArg1<void, const char*> cb;
+    };
+    oob _oobs[ATPARSER_MAX_OOBS];
+    int _oob_count;
+    bool _aborted;
+
 public:
     /**
     * Constructor
@@ -65,7 +80,9 @@ public:
     */
     ATParser(BufferedSerial &serial, const char *delimiter = "\r\n", int buffer_size = 256, int timeout = 8000, uint8_t echo = 0) :
         _serial(&serial),
-        _buffer_size(buffer_size) {
+        _buffer_size(buffer_size),
+        _oob_count(0),
+        _aborted(false) {
         _buffer = new char[buffer_size];
         setTimeout(timeout);
         setDelimiter(delimiter);
@@ -197,5 +214,47 @@ public:
     * Flushes the underlying stream
     */
     void flush();
+
+    /**
+    * Attach a callback for out-of-band data
+    *
+    * Whenever a line starting with prefix is received, either while
+    * waiting in recv() or in process(), the callback is called with the
+    * prefix. The callback can use recv() and read() to consume the rest
+    * of the out-of-band data.
+    *
+    * @param prefix string that starts the out-of-band data
+    * @param func callback to call when the prefix is received
+    * @return true only if the callback was attached
+    */
+    bool oob(const char *prefix, FunctionPointerArg1<void, const char*> func);
+
+    template <typename T>
+    bool oob(const char *prefix, T *object, void (T::*member)(const char*)) {
+        return oob(prefix, FunctionPointerArg1<void, const char*>(object, member));
+    }
+
+    /**
+    * Process out-of-band data that has already arrived
+    *
+    * Reads lines from the underlying stream while data is available,
+    * calling the callbacks of any out-of-band prefixes found.
+    *
+    * @return true only if an out-of-band callback was called
+    */
+    bool process();
+
+    /**
+    * Abort the recv() in progress
+    *
+    * Meant for out-of-band callbacks that receive a reply which rules
+    * out the expected response, so recv() fails without a timeout.
+    */
+    void abort();
+
+private:
+    // Calls the callback of an out-of-band prefix matching the
+    // first size characters of line, returns true if one was found
+    bool dispatch_oob(const char *line, int size);
 };
 
@@ -20,6 +20,44 @@ ESP8266::ESP8266(PinName tx, PinName rx) : serial(tx, rx), atParser(serial)
 {
     serial.baud(115200);
     atParser.setEcho(1);
+    timeout = 8000;
+    openingID = -1;
+    serverActive = false;
+    backlog = 0;
+    pendingCount = 0;
+    rejected = 0;
+    noAP = false;
+    cmdError = false;
+    dnsFail = false;
+    wifiChanged = true;
+    joining = false;
+    joinResult = -1;
+    scanCount = 0;
+    scanValid = false;
+    scanTTL = 10000;
+    for(int i=0; i<numLinks; i++) {
+        links[i].open = false;
+        clearLink(i, false);
+    }
+    atParser.oob("+IPD,", this, &ESP8266::packetHandler);
+    atParser.oob("0,CLOSED", this, &ESP8266::closedHandler);
+    atParser.oob("1,CLOSED", this, &ESP8266::closedHandler);
+    atParser.oob("2,CLOSED", this, &ESP8266::closedHandler);
+    atParser.oob("3,CLOSED", this, &ESP8266::closedHandler);
+    atParser.oob("4,CLOSED", this, &ESP8266::closedHandler);
+    atParser.oob("0,CONNECT", this, &ESP8266::connectedHandler);
+    atParser.oob("1,CONNECT", this, &ESP8266::connectedHandler);
+    atParser.oob("2,CONNECT", this, &ESP8266::connectedHandler);
+    atParser.oob("3,CONNECT", this, &ESP8266::connectedHandler);
+    atParser.oob("4,CONNECT", this, &ESP8266::connectedHandler);
+    atParser.oob("No AP", this, &ESP8266::noAPHandler);
+    atParser.oob("FAIL", this, &ESP8266::joinFailHandler);
+    atParser.oob("ERROR", this, &ESP8266::abortHandler);
+    atParser.oob("SEND FAIL", this, &ESP8266::abortHandler);
+    atParser.oob("DNS Fail", this, &ESP8266::dnsFailHandler);
+    atParser.oob("+CWLAP:", this, &ESP8266::scanHandler);
+    atParser.oob("WIFI GOT IP", this, &ESP8266::wifiHandler);
+    atParser.oob("WIFI DISCONNECT", this, &ESP8266::wifiHandler);
 }
 
 bool ESP8266::startup(void)
@@ -54,6 +92,11 @@ bool ESP8266::multipleConnections(bool enabled)
     return (atParser.send(mux_command.c_str()) && atParser.recv("OK"));
 }
 
+bool ESP8266::remoteInfo(bool enabled)
+{
+    return (atParser.send("AT+CIPDINFO=%d", enabled ? 1 : 0) && atParser.recv("OK"));
+}
+
 bool ESP8266::dhcp(int mode, bool enabled)
 {
     //only 3 valid modes
@@ -69,12 +112,154 @@ bool ESP8266::dhcp(int mode, bool enabled)
     return (atParser.send(mode_command.c_str()) && atParser.recv("OK"));
 }
 
-bool ESP8266::connect(const char *ap, const char *passPhrase)
+bool ESP8266::setStaticIP(const char *ip, const char *gateway, const char *netmask)
+{
+    return (atParser.send("AT+CIPSTA_CUR=\"%s\",\"%s\",\"%s\"", ip, gateway, netmask) && atParser.recv("OK"));
+}
+
+bool ESP8266::connect(const char *ap, const char *passPhrase, const char *bssid)
 {
+    if (bssid) {
+        //Join the known AP for this session only, the AP saved in flash is kept
+        return (atParser.send("AT+CWJAP_CUR=\"%s\",\"%s\",\"%s\"", ap, passPhrase, bssid) && atParser.recv("OK"));
+    }
     string connect_command = "AT+CWJAP=\""+(string)ap+"\",\""+(string)passPhrase+"\"";
     return (atParser.send(connect_command.c_str()) && atParser.recv("OK"));
 }
 
+bool ESP8266::startConnect(const char *ap, const char *passPhrase, const char *bssid)
+{
+    bool sent;
+    if (bssid) {
+        sent = atParser.send("AT+CWJAP_CUR=\"%s\",\"%s\",\"%s\"", ap, passPhrase, bssid);
+    } else {
+        sent = atParser.send("AT+CWJAP=\"%s\",\"%s\"", ap, passPhrase);
+    }
+    joining = sent;
+    joinResult = sent ? 0 : -1;
+    return sent;
+}
+
+int ESP8266::connectResult(void)
+{
+    if (!joining) {
+        return joinResult;
+    }
+    //The join ends with OK, or with FAIL caught by joinFailHandler
+    atParser.setTimeout(0);
+    if (atParser.recv("OK")) {
+        joining = false;
+        joinResult = 1;
+    }
+    atParser.setTimeout(timeout);
+    return joining ? 0 : joinResult;
+}
+
+bool ESP8266::getAPInfo(char *ap, char *bssid, int *channel, int *rssi)
+{
+    int level;
+    if (!rssi) {
+        rssi = &level;
+    }
+    noAP = false;
+    if (atParser.send("AT+CWJAP_CUR?") && atParser.recv("+CWJAP_CUR:\"%32[^\"]\",\"%17[^\"]\",%d,%d\r\n", ap, bssid, channel, rssi)) {
+        return atParser.recv("OK");
+    }
+    if (noAP) {
+        //Not connected is answered with "No AP", which aborts the recv early
+        atParser.recv("OK");
+    }
+    return false;
+}
+
+int ESP8266::scan(esp8266_ap_t *res, int count, const char *ssid, int minRSSI)
+{
+    if (ssid && strlen(ssid) >= sizeof(scanSSID)) {
+        return -1;
+    }
+    const char *key = (ssid) ? ssid : "";
+    if (!scanValid || scanTTL == 0 || (uint32_t)scanAge.read_ms() >= scanTTL || strcmp(scanSSID, key) != 0) {
+        //Sorted by RSSI with every field listed, older firmware ignores this with ERROR
+        if (atParser.send("AT+CWLAPOPT=1,31")) {
+            atParser.recv("OK");
+        }
+        scanValid = false;
+        scanCount = 0;
+        //A scan visits every channel, which takes longer than most commands
+        atParser.setTimeout((timeout > 10000) ? timeout : 10000);
+        bool ok = (ssid) ? atParser.send("AT+CWLAP=\"%s\"", ssid) : atParser.send("AT+CWLAP");
+        ok = ok && atParser.recv("OK");
+        atParser.setTimeout(timeout);
+        if (!ok) {
+            return -1;
+        }
+        strcpy(scanSSID, key);
+        scanValid = true;
+        scanAge.reset();
+        scanAge.start();
+    }
+
+    int found = 0;
+    for (int i = 0; i < scanCount && found < count; i++) {
+        if (scanCache[i].rssi >= minRSSI) {
+            res[found++] = scanCache[i];
+        }
+    }
+    return found;
+}
+
+void ESP8266::setScanTTL(uint32_t ttl_ms)
+{
+    scanTTL = ttl_ms;
+}
+
+//A name goes into the AT command as it is, so it must be a plain hostname:
+//at most 253 characters, labels of 1-63 letters, digits, '-' or '_', and
+//no quote, control character or anything else the module would see as syntax
+static bool validHostname(const char *name)
+{
+    int len = 0;
+    int label = 0;
+    for (const char *p = name; *p; p++) {
+        char c = *p;
+        if (++len > 253) {
+            return false;
+        }
+        if (c == '.') {
+            if (label == 0) {
+                return false;
+            }
+            label = 0;
+        } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_') {
+            if (++label > 63) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return len > 0;
+}
+
+int ESP8266::resolve(const char *name, char *ip)
+{
+    if (name == NULL || !validHostname(name)) {
+        return -3;
+    }
+    cmdError = false;
+    dnsFail = false;
+    if (atParser.send("AT+CIPDOMAIN=\"%s\"", name)
+        && atParser.recv("+CIPDOMAIN:%15[^\r]\r\n", ip)
+        && atParser.recv("OK")) {
+        return 1;
+    }
+    if (dnsFail) {
+        return 0;
+    }
+    //Firmware without AT+CIPDOMAIN answers ERROR alone
+    return cmdError ? -1 : -2;
+}
+
 bool ESP8266::disconnect(void)
 {
     return (atParser.send("AT+CWQAP") && atParser.recv("OK"));
@@ -85,55 +270,535 @@ bool ESP8266::getIPAddress(char* ip)
     return (atParser.send("AT+CIPSTA?") && atParser.recv("+CIPSTA:\"%[^\"]\"", ip));
 }
 
+bool ESP8266::getNetworkInfo(char *ip, char *gateway, char *netmask)
+{
+    return (atParser.send("AT+CIPSTA_CUR?")
+        && atParser.recv("+CIPSTA_CUR:ip:\"%15[^\"]\"", ip)
+        && atParser.recv("+CIPSTA_CUR:gateway:\"%15[^\"]\"", gateway)
+        && atParser.recv("+CIPSTA_CUR:netmask:\"%15[^\"]\"", netmask)
+        && atParser.recv("OK"));
+}
+
+bool ESP8266::getMACAddress(char *mac)
+{
+    return (atParser.send("AT+CIPSTAMAC_CUR?") && atParser.recv("+CIPSTAMAC_CUR:\"%17[^\"]\"", mac) && atParser.recv("OK"));
+}
+
 bool ESP8266::isConnected(void)
 {
-    char* ip = "";
-    return getIPAddress(ip);
+    char ip[16], gateway[16], netmask[16];
+    return getNetworkInfo(ip, gateway, netmask) && strcmp(ip, "0.0.0.0") != 0;
 }
 
-bool ESP8266::openSocket(string sockType, int id, int port, const char* addr)
+bool ESP8266::statusChanged(void)
+{
+    bool changed = wifiChanged;
+    wifiChanged = false;
+    return changed;
+}
+
+bool ESP8266::openSocket(string sockType, int id, int port, const char* addr, int keepalive)
 {
     //IDs only 0-4
     if(id > 4) {
         return false;
     }
-    char portstr[5];
+    char portstr[6];
     char idstr[2];
     sprintf(idstr,"%d",id);
     sprintf(portstr, "%d", port);
 
     string start_command = "AT+CIPSTART="+(string)idstr+",\""+sockType+"\",\""+(string)addr+"\","+(string)portstr;
-    if (!(atParser.send(start_command.c_str()) && atParser.recv("OK"))) {
+    //keepalive is only valid for TCP, range 1-7200 seconds
+    if (keepalive > 0 && sockType == "TCP") {
+        char keepalivestr[12];
+        if (keepalive > 7200) {
+            keepalive = 7200;
+        }
+        snprintf(keepalivestr, sizeof(keepalivestr), "%d", keepalive);
+        start_command += ","+(string)keepalivestr;
+    }
+    openingID = id;
+    bool opened = atParser.send(start_command.c_str()) && atParser.recv("OK");
+    openingID = -1;
+    if (!opened) {
         return false;//opening socket not succesful
     }
+    links[id].open = true;
+    clearLink(id, sockType == "UDP");
     return true;
 }
 
-bool ESP8266::sendData(int id, const void *data, uint32_t amount)
+bool ESP8266::openDatagram(int id, const char* addr, int port, int localPort)
 {
-    char idstr[2];
-    sprintf(idstr,"%d",id);
-    char lenstr[5];
-    sprintf(lenstr,"%d",(int)amount);
+    //IDs only 0-4
+    if(id < 0 || id > 4) {
+        return false;
+    }
+    openingID = id;
+    bool opened = atParser.send("AT+CIPSTART=%d,\"UDP\",\"%s\",%d,%d,2", id, addr, port, localPort)
+        && atParser.recv("OK");
+    openingID = -1;
+    if (!opened) {
+        return false;
+    }
+    links[id].open = true;
+    clearLink(id, true);
+    return true;
+}
+
+bool ESP8266::sendData(int id, const void *data, uint32_t amount, const char *addr, int port)
+{
+    return sendBegin(id, amount, addr, port) && sendWrite(data, amount) && sendEnd();
+}
+
+bool ESP8266::sendBegin(int id, uint32_t amount, const char *addr, int port)
+{
+    if (amount == 0 || amount > ESP8266_MAX_SEND) {
+        return false;
+    }
+    bool sent;
+    if (addr) {
+        sent = atParser.send("AT+CIPSEND=%d,%d,\"%s\",%d", id, (int)amount, addr, port);
+    } else {
+        sent = atParser.send("AT+CIPSEND=%d,%d", id, (int)amount);
+    }
+    //The payload may follow as soon as the prompt arrives
+    return sent && atParser.recv(">");
+}
+
+bool ESP8266::sendWrite(const void *data, uint32_t amount)
+{
+    return atParser.write((const char*)data, (int)amount) == (int)amount;
+}
+
+bool ESP8266::sendEnd(void)
+{
+    //"SEND FAIL" and "ERROR" abort the wait
+    return atParser.recv("SEND OK");
+}
+
+uint32_t ESP8266::recv(int id, void *data, uint32_t amount)
+{
+    //Datagrams are not run together
+    if (id >= 0 && id < numLinks && links[id].datagram) {
+        return recvFrom(id, NULL, NULL, data, amount);
+    }
+
+    //Wait for the first piece, the second piece of a wrapped ring is already buffered
+    const void *lent;
+    uint32_t received = 0;
+    uint32_t count = recvLend(id, &lent);
+    while (count > 0 && received < amount) {
+        if (count > amount - received) {
+            count = amount - received;
+        }
+        memcpy((char*)data + received, lent, count);
+        recvRelease(id, count);
+        received += count;
+        count = (links[id].count > 0) ? recvLend(id, &lent) : 0;
+    }
+    return received;
+}
+
+uint32_t ESP8266::recvFrom(int id, char *ip, uint16_t *port, void *data, uint32_t amount)
+{
+    if (ip) {
+        ip[0] = 0;
+    }
+    if (port) {
+        *port = 0;
+    }
+    if (id < 0 || id >= numLinks || !links[id].datagram) {
+        return recv(id, data, amount);
+    }
+
+    const void *lent;
+    uint32_t count = recvLend(id, &lent);
+    if (count == 0) {
+        return 0;
+    }
+    Link &link = links[id];
+    const Datagram &packet = link.packets[link.packetHead];
+    if (ip) {
+        strcpy(ip, packet.ip);
+    }
+    if (port) {
+        *port = packet.port;
+    }
+
+    //recvLend stops at the end of the datagram, the release of its last byte drops it
+    uint32_t length = packet.length;
+    uint32_t received = 0;
+    while (count > 0 && received < amount) {
+        if (count > amount - received) {
+            count = amount - received;
+        }
+        memcpy((char*)data + received, lent, count);
+        recvRelease(id, count);
+        received += count;
+        count = (received < length) ? recvLend(id, &lent) : 0;
+    }
+    recvRelease(id, length - received);
+    return received;
+}
+
+uint32_t ESP8266::recvLend(int id, const void **data)
+{
+    //IDs only 0-4
+    if(id < 0 || id > 4) {
+        return 0;
+    }
+    Link &link = links[id];
+    Timer timer;
+    timer.start();
+
+    //Wait for the +IPD handler to buffer some data
+    while (link.count == 0) {
+        if (!link.open || timer.read_ms() > (int)timeout) {
+            return 0;
+        }
+        atParser.process();
+    }
+
+    //The handler only writes past the buffered data, so the lent part stays put
+    uint32_t count = ESP8266_RX_BUFFER_SIZE - link.head;
+    if (count > link.count) {
+        count = link.count;
+    }
+    if (link.datagram && count > link.packets[link.packetHead].length) {
+        count = link.packets[link.packetHead].length;
+    }
+    *data = &link.buffer[link.head];
+    return count;
+}
+
+void ESP8266::recvRelease(int id, uint32_t amount)
+{
+    if(id < 0 || id > 4) {
+        return;
+    }
+    Link &link = links[id];
+    if (amount > link.count) {
+        amount = link.count;
+    }
+    link.head = (link.head + amount) % ESP8266_RX_BUFFER_SIZE;
+    link.count -= amount;
+
+    //Drop the datagrams that were read up
+    while (link.datagram && amount > 0 && link.packetCount > 0) {
+        Datagram &packet = link.packets[link.packetHead];
+        uint32_t used = (amount < packet.length) ? amount : packet.length;
+        packet.length -= used;
+        amount -= used;
+        if (packet.length == 0) {
+            link.packetHead = (link.packetHead + 1) % ESP8266_DATAGRAM_QUEUE;
+            link.packetCount--;
+        }
+    }
+}
+
+void ESP8266::clearLink(int id, bool datagram)
+{
+    if (id < 0 || id >= numLinks) {
+        return;
+    }
+    links[id].head = 0;
+    links[id].count = 0;
+    links[id].datagram = datagram;
+    links[id].packetHead = 0;
+    links[id].packetCount = 0;
+}
 
-    string send_command = "AT+CIPSEND="+(string)idstr+","+(string)lenstr;
-    if(!atParser.send(send_command.c_str(),">")) {
+bool ESP8266::startServer(int port, int backlog)
+{
+    if (backlog < 1) {
+        backlog = 1;
+    } else if (backlog > numLinks) {
+        backlog = numLinks;
+    }
+    this->backlog = backlog;
+    pendingCount = 0;
+    if (!(atParser.send("AT+CIPSERVER=1,%d", port) && atParser.recv("OK"))) {
         return false;
     }
-    wait_ms(10);
-    atParser.write((char*)data, (int)amount);
-    wait_ms(10);
+    serverActive = true;
     return true;
 }
 
-uint32_t ESP8266::recv(void *data, uint32_t amount)
+bool ESP8266::stopServer(void)
 {
-    int length;
-    int id;
-    if (!(atParser.recv("+IPD,%d,%d:", &id, &length) && atParser.read((char*)data, length) && atParser.recv("OK"))) {
+    serverActive = false;
+    bool stopped = atParser.send("AT+CIPSERVER=0") && atParser.recv("OK");
+    while (pendingCount > 0) {
+        close(pending[--pendingCount]);
+    }
+    return stopped;
+}
+
+int ESP8266::accept(void)
+{
+    Timer timer;
+    timer.start();
+
+    while (pendingCount == 0) {
+        if (!serverActive || timer.read_ms() > (int)timeout) {
+            return -1;
+        }
+        process();
+    }
+
+    int id = pending[0];
+    pendingCount--;
+    for (int i = 0; i < pendingCount; i++) {
+        pending[i] = pending[i+1];
+    }
+    return id;
+}
+
+int ESP8266::pendingConnections(void)
+{
+    return pendingCount;
+}
+
+uint32_t ESP8266::readable(int id)
+{
+    //IDs only 0-4
+    if(id > 4) {
         return 0;
     }
-    return length;
+    return links[id].count;
+}
+
+bool ESP8266::isOpen(int id)
+{
+    //IDs only 0-4
+    if(id > 4) {
+        return false;
+    }
+    return links[id].open;
+}
+
+bool ESP8266::process(void)
+{
+    bool handled = atParser.process();
+
+    //Commands cannot be sent from a handler, so refused links are closed here
+    for (int id = 0; rejected; id++) {
+        if (rejected & (1 << id)) {
+            rejected &= ~(1 << id);
+            close(id);
+        }
+    }
+    return handled;
+}
+
+void ESP8266::packetHandler(const char *prefix)
+{
+    //"id,len:" or with AT+CIPDINFO=1 "id,len,ip,port:"
+    char header[40];
+    int n = 0;
+    while (true) {
+        int c = atParser.getc();
+        if (c < 0) {
+            return;
+        }
+        if (c == ':') {
+            break;
+        }
+        if (n+1 >= (int)sizeof(header)) {
+            return;
+        }
+        header[n++] = c;
+    }
+    header[n] = 0;
+
+    int id;
+    int amount;
+    char ip[16] = "";
+    int port = 0;
+    if (sscanf(header, "%d,%d,%15[^,],%d", &id, &amount, ip, &port) < 2) {
+        return;
+    }
+    if (id < 0 || id > 4) {
+        //Not a link we know about, skip the data
+        for (int i = 0; i < amount; i++) {
+            atParser.getc();
+        }
+        return;
+    }
+
+    //A datagram is kept whole or not at all
+    Link &link = links[id];
+    if (link.datagram && (amount > (int)(ESP8266_RX_BUFFER_SIZE - link.count) ||
+            link.packetCount == ESP8266_DATAGRAM_QUEUE || amount == 0)) {
+        for ( ; amount > 0; amount--) {
+            atParser.getc();
+        }
+        return;
+    }
+
+    //Copy straight into the ring buffer, at most in two pieces
+    uint32_t stored = 0;
+    while (amount > 0) {
+        uint32_t tail = (link.head + link.count) % ESP8266_RX_BUFFER_SIZE;
+        uint32_t space = ESP8266_RX_BUFFER_SIZE - link.count;
+        if (space == 0) {
+            break;
+        }
+        if (space > ESP8266_RX_BUFFER_SIZE - tail) {
+            space = ESP8266_RX_BUFFER_SIZE - tail;
+        }
+        if (space > (uint32_t)amount) {
+            space = amount;
+        }
+        if (atParser.read(&link.buffer[tail], space) < 0) {
+            //The rest of the data is lost with the serial timeout
+            amount = 0;
+            break;
+        }
+        link.count += space;
+        stored += space;
+        amount -= space;
+    }
+
+    if (link.datagram && stored > 0) {
+        Datagram &packet = link.packets[(link.packetHead + link.packetCount) % ESP8266_DATAGRAM_QUEUE];
+        strcpy(packet.ip, ip);
+        packet.port = (uint16_t)port;
+        packet.length = (uint16_t)stored;
+        link.packetCount++;
+    }
+
+    //Buffer full, data that does not fit is dropped
+    for ( ; amount > 0; amount--) {
+        atParser.getc();
+    }
+}
+
+void ESP8266::wifiHandler(const char *prefix)
+{
+    wifiChanged = true;
+}
+
+void ESP8266::scanHandler(const char *prefix)
+{
+    //Read the rest of the line, (ecn,"ssid",rssi,"mac",channel...)
+    char line[96];
+    int len = 0;
+    while (true) {
+        int c = atParser.getc();
+        if (c < 0 || c == '\n') {
+            break;
+        }
+        if (len < (int)sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+    line[len] = 0;
+
+    //The SSID is taken up to the last quote before the RSSI, so that it
+    //may be empty or contain quotes itself
+    esp8266_ap_t ap;
+    int ecn;
+    int start = 0;
+    if (sscanf(line, "(%d,\"%n", &ecn, &start) < 1 || start == 0) {
+        return;
+    }
+    const char *end = strstr(line + start, "\",-");
+    if (!end) {
+        end = strstr(line + start, "\",");
+    }
+    if (!end || end - (line + start) >= (int)sizeof(ap.ssid)) {
+        return;
+    }
+    int rssi;
+    int channel;
+    if (sscanf(end, "\",%d,\"%17[^\"]\",%d", &rssi, ap.bssid, &channel) != 3) {
+        return;
+    }
+    memcpy(ap.ssid, line + start, end - (line + start));
+    ap.ssid[end - (line + start)] = 0;
+    ap.rssi = rssi;
+    ap.channel = channel;
+    ap.ecn = ecn;
+
+    //Keep the strongest APs in order, the list usually arrives sorted already
+    int pos = scanCount;
+    while (pos > 0 && scanCache[pos-1].rssi < ap.rssi) {
+        pos--;
+    }
+    if (pos >= ESP8266_SCAN_CACHE_SIZE) {
+        return;
+    }
+    int last = (scanCount < ESP8266_SCAN_CACHE_SIZE) ? scanCount : ESP8266_SCAN_CACHE_SIZE - 1;
+    for (int i = last; i > pos; i--) {
+        scanCache[i] = scanCache[i-1];
+    }
+    scanCache[pos] = ap;
+    if (scanCount < ESP8266_SCAN_CACHE_SIZE) {
+        scanCount++;
+    }
+}
+
+void ESP8266::abortHandler(const char *prefix)
+{
+    cmdError = true;
+    atParser.abort();
+}
+
+void ESP8266::dnsFailHandler(const char *prefix)
+{
+    //The ERROR that follows ends the command
+    dnsFail = true;
+}
+
+void ESP8266::noAPHandler(const char *prefix)
+{
+    noAP = true;
+    atParser.abort();
+}
+
+void ESP8266::joinFailHandler(const char *prefix)
+{
+    //A failed join ends with FAIL instead of OK
+    if (joining) {
+        joining = false;
+        joinResult = -1;
+    }
+    atParser.abort();
+}
+
+void ESP8266::closedHandler(const char *prefix)
+{
+    int id = prefix[0] - '0';
+    links[id].open = false;
+
+    //A connection closed before it was accepted is dropped from the queue
+    for (int i = 0; i < pendingCount; i++) {
+        if (pending[i] == id) {
+            pendingCount--;
+            for ( ; i < pendingCount; i++) {
+                pending[i] = pending[i+1];
+            }
+            break;
+        }
+    }
+}
+
+void ESP8266::connectedHandler(const char *prefix)
+{
+    int id = prefix[0] - '0';
+    if (id == openingID) {
+        return;//our own AT+CIPSTART
+    }
+    if (!serverActive || pendingCount >= backlog) {
+        rejected |= 1 << id;
+        return;
+    }
+    links[id].open = true;
+    clearLink(id, false);
+    pending[pendingCount++] = id;
 }
 
 bool ESP8266::close(int id)
@@ -146,10 +811,14 @@ bool ESP8266::close(int id)
     sprintf(idstr,"%d",id);
     string close_command = "AT+CIPCLOSE="+(string)idstr;
 
+    //Data that was not read is discarded with the link
+    links[id].open = false;
+    clearLink(id, false);
     return (atParser.send(close_command.c_str()) && atParser.recv("OK"));
 }
 
 void ESP8266::setTimeout(uint32_t timeout_ms)
 {
+    timeout = timeout_ms;
     atParser.setTimeout(timeout_ms);
 }
\ No newline at end of file
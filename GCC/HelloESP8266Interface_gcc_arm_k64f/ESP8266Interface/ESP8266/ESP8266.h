@@ -20,6 +20,34 @@
 #include "ATParser.h"
 #include <string>
 
+#ifndef ESP8266_RX_BUFFER_SIZE
+#define ESP8266_RX_BUFFER_SIZE 2048
+#endif
+
+/* Largest payload of a single AT+CIPSEND */
+#ifndef ESP8266_MAX_SEND
+#define ESP8266_MAX_SEND 2048
+#endif
+
+/* Datagrams buffered per UDP link, each keeps its remote address */
+#ifndef ESP8266_DATAGRAM_QUEUE
+#define ESP8266_DATAGRAM_QUEUE 4
+#endif
+
+#ifndef ESP8266_SCAN_CACHE_SIZE
+#define ESP8266_SCAN_CACHE_SIZE 8
+#endif
+
+/** Access point found by ESP8266::scan
+ */
+typedef struct esp8266_ap_t {
+    char ssid[33];          /*!< Name of the AP */
+    char bssid[18];         /*!< MAC address of the AP */
+    int8_t rssi;            /*!< Signal strength in dBm */
+    uint8_t channel;        /*!< WiFi channel */
+    uint8_t ecn;            /*!< Encryption, 0 open, 1 WEP, 2 WPA, 3 WPA2, 4 WPA/WPA2 */
+} esp8266_ap_t;
+
 /** ESP8266Interface class.
     This is an interface to a ESP8266 radio.
  */
@@ -58,6 +86,14 @@ public:
     */
     bool multipleConnections(bool enabled);
     
+    /**
+    * Enable/Disable the remote IP and port in +IPD notifications
+    *
+    * @param enabled remote address reported when true
+    * @return true only if the firmware supports AT+CIPDINFO and accepted the setting
+    */
+    bool remoteInfo(bool enabled);
+    
     /**
     * Enable/Disable DHCP
     *
@@ -67,14 +103,91 @@ public:
     */
     bool dhcp(int mode, bool enabled);
     
+    /**
+    * Set a static IP address for station mode, which also stops DHCP
+    *
+    * @param ip the IP address
+    * @param gateway the gateway address
+    * @param netmask the network mask
+    * @return true only if the address is set successfully
+    */
+    bool setStaticIP(const char *ip, const char *gateway, const char *netmask);
+    
     /**
     * Connect ESP8266 to AP
     *
     * @param ap the name of the AP
     * @param passPhrase the password of AP
+    * @param bssid MAC address of the AP to join, skips the search for ap when given
     * @return true only if ESP8266 is connected successfully
     */
-    bool connect(const char *ap, const char *passPhrase);
+    bool connect(const char *ap, const char *passPhrase, const char *bssid = NULL);
+    
+    /**
+    * Start joining an AP without waiting for the result
+    *
+    * The ESP8266 answers other commands with "busy" until the join ends,
+    * only connectResult() should be called until then.
+    *
+    * @param ap the name of the AP
+    * @param passPhrase the password of AP
+    * @param bssid MAC address of the AP to join, skips the search for ap when given
+    * @return true if the join was started
+    */
+    bool startConnect(const char *ap, const char *passPhrase, const char *bssid = NULL);
+    
+    /**
+    * Check for the end of a join started with startConnect
+    *
+    * Reads what the ESP8266 already sent, waits about a millisecond at most.
+    *
+    * @return 1 when joined, -1 when the join failed, 0 while it is still running
+    */
+    int connectResult(void);
+    
+    /**
+    * Get the AP ESP8266 is connected to
+    *
+    * @param ap data placeholder for the name of the AP, 33 bytes
+    * @param bssid data placeholder for the MAC address of the AP, 18 bytes
+    * @param channel data placeholder for the channel of the AP
+    * @param rssi data placeholder for the signal strength of the AP in dBm, may be NULL
+    * @return true only if ESP8266 is connected to an AP
+    */
+    bool getAPInfo(char *ap, char *bssid, int *channel, int *rssi = NULL);
+    
+    /**
+    * Scan for APs, strongest first
+    *
+    * Results of a scan with the same ssid are reused until they are
+    * older than the TTL set with setScanTTL, only the strongest
+    * ESP8266_SCAN_CACHE_SIZE APs of a scan are kept.
+    *
+    * @param res array the found APs are copied into
+    * @param count number of entries in res
+    * @param ssid only scan for APs with this name, NULL for all APs
+    * @param minRSSI leave out APs weaker than this, in dBm
+    * @return number of APs copied into res, -1 if the scan failed
+    */
+    int scan(esp8266_ap_t *res, int count, const char *ssid = NULL, int minRSSI = -128);
+    
+    /**
+    * Set how long scan results are reused
+    *
+    * @param ttl_ms age in milliseconds after which scan() scans again, 0 to always scan
+    */
+    void setScanTTL(uint32_t ttl_ms);
+    
+    /**
+    * Resolve a hostname with the DNS client of ESP8266
+    *
+    * @param name the hostname to resolve
+    * @param ip data placeholder for the IP address, 16 bytes
+    * @return 1 if resolved, 0 if the name was not found,
+    *         -1 if the command was refused, -2 if there was no reply,
+    *         -3 if name is not a valid hostname, nothing is sent then
+    */
+    int resolve(const char *name, char *ip);
     
     /**
     * Disconnect ESP8266 from AP
@@ -91,6 +204,24 @@ public:
     */
     bool getIPAddress(char* ip);
     
+    /**
+    * Get the station address, gateway and network mask of ESP8266
+    *
+    * @param ip data placeholder for the IP address, 16 bytes
+    * @param gateway data placeholder for the gateway address, 16 bytes
+    * @param netmask data placeholder for the network mask, 16 bytes
+    * @return true only if the addresses are read successfully
+    */
+    bool getNetworkInfo(char *ip, char *gateway, char *netmask);
+    
+    /**
+    * Get the station MAC address of ESP8266
+    *
+    * @param mac data placeholder for the MAC address, 18 bytes
+    * @return true only if the address is read successfully
+    */
+    bool getMACAddress(char *mac);
+    
     /**
     * Check if ESP8266 is conenected
     *
@@ -98,6 +229,16 @@ public:
     */
     bool isConnected(void);
     
+    /**
+    * Check for a change of the connection to the AP
+    *
+    * Set by the unsolicited WIFI GOT IP and WIFI DISCONNECT messages,
+    * which are only seen while a command runs or from process().
+    *
+    * @return true if the connection changed since the last call
+    */
+    bool statusChanged(void);
+    
     /**
     * Open a socketed connection 
     *
@@ -105,28 +246,164 @@ public:
     * @param id id to give the new socket, valid 0-4
     * @param port port to open connection with
     * @param addr the IP address of the destination 
+    * @param keepalive TCP keepalive interval in seconds, 0 disables it, limited to 7200
     * @return true only if socket opened successfully
     */
-    bool openSocket(string sockType, int id, int port, const char* addr);
+    bool openSocket(string sockType, int id, int port, const char* addr, int keepalive = 0);
+    
+    /**
+    * Open a UDP link whose remote may change, AT+CIPSTART UDP mode 2
+    *
+    * @param id id to give the new socket, valid 0-4
+    * @param addr the IP address of the first destination, "0.0.0.0" if none
+    * @param port port of the first destination, 0 if none
+    * @param localPort port the link receives on
+    * @return true only if socket opened successfully
+    */
+    bool openDatagram(int id, const char* addr, int port, int localPort);
     
     /**
     * Sends data to an open socket
     *
     * @param id id of socket to send to
     * @param data data to be sent
-    * @param amount amount of data to be sent - max 1024
+    * @param amount amount of data to be sent - max ESP8266_MAX_SEND
+    * @param addr IP address to send a UDP datagram to, NULL for the remote of the link
+    * @param port port to send a UDP datagram to
     * @return true only if data sent successfully
     */
-    bool sendData(int id, const void *data, uint32_t amount);
+    bool sendData(int id, const void *data, uint32_t amount, const char *addr = NULL, int port = 0);
+    
+    /**
+    * Start sending data to an open socket, the data follows in sendWrite calls
+    *
+    * @param id id of socket to send to
+    * @param amount total amount of data that will be written - max ESP8266_MAX_SEND
+    * @param addr IP address to send a UDP datagram to, NULL for the remote of the link
+    * @param port port to send a UDP datagram to
+    * @return true only if the ESP8266 is ready for the data
+    */
+    bool sendBegin(int id, uint32_t amount, const char *addr = NULL, int port = 0);
+    
+    /**
+    * Write part of the data announced by sendBegin
+    *
+    * @param data data to be sent
+    * @param amount amount of data to be sent
+    * @return true only if the data was written
+    */
+    bool sendWrite(const void *data, uint32_t amount);
+    
+    /**
+    * Finish a send once all announced data is written
+    *
+    * @return true only if the ESP8266 confirmed the send
+    */
+    bool sendEnd(void);
     
     /**
     * Receives data from an open socket 
     *
+    * Waits up to the timeout for data buffered from +IPD notifications
+    *
+    * @param id id of socket to receive from
     * @param data placeholder for returned information
     * @param amount number of bytes to be received
     * @return the number of bytes actually received
     */
-    uint32_t recv(void *data, uint32_t amount);
+    uint32_t recv(int id, void *data, uint32_t amount);
+    
+    /**
+    * Receives a datagram from a UDP socket
+    *
+    * Waits up to the timeout like recv. The part of the datagram that does
+    * not fit into data is dropped. Stream sockets receive like recv.
+    *
+    * @param id id of socket to receive from
+    * @param ip receives the IP address of the sender, 16 bytes, empty if unknown
+    * @param port receives the port of the sender, 0 if unknown
+    * @param data placeholder for returned information
+    * @param amount number of bytes to be received
+    * @return the number of bytes actually received
+    */
+    uint32_t recvFrom(int id, char *ip, uint16_t *port, void *data, uint32_t amount);
+    
+    /**
+    * Lend out data buffered for a socket without copying it
+    *
+    * Waits up to the timeout for data like recv. The data stays in place
+    * until it is given back with recvRelease.
+    *
+    * @param id id of socket to receive from
+    * @param data set to the start of the buffered data
+    * @return the number of bytes lent out, at most up to the end of the buffer
+    */
+    uint32_t recvLend(int id, const void **data);
+    
+    /**
+    * Give back data lent out by recvLend
+    *
+    * @param id id of socket the data was received from
+    * @param amount number of bytes consumed
+    */
+    void recvRelease(int id, uint32_t amount);
+    
+    /**
+    * Start a TCP server, incoming connections are queued until accepted
+    *
+    * @param port port to listen on
+    * @param backlog number of connections queued before new ones are refused
+    * @return true only if the server started successfully
+    */
+    bool startServer(int port, int backlog);
+    
+    /**
+    * Stop the TCP server and close connections that were not accepted
+    *
+    * @return true only if the server stopped successfully
+    */
+    bool stopServer(void);
+    
+    /**
+    * Accept a queued incoming connection
+    *
+    * Waits up to the timeout for a connection when none is queued
+    *
+    * @return id of the connected socket, -1 if no connection arrived
+    */
+    int accept(void);
+    
+    /**
+    * Check how many incoming connections are waiting to be accepted
+    *
+    * @return number of queued connections
+    */
+    int pendingConnections(void);
+    
+    /**
+    * Check how much received data is buffered for a socket
+    *
+    * @param id id of socket to check
+    * @return number of bytes that can be read without waiting
+    */
+    uint32_t readable(int id);
+    
+    /**
+    * Check if a socket is connected
+    *
+    * @param id id of socket to check
+    * @return true only if the socket is open and has not been closed by the remote side
+    */
+    bool isOpen(int id);
+    
+    /**
+    * Handle notifications the ESP8266 has sent since the last command
+    *
+    * Buffers incoming +IPD data and tracks closed links without waiting
+    *
+    * @return true only if a notification was handled
+    */
+    bool process(void);
     
     /**
     * Closes a socket
@@ -143,9 +420,81 @@ public:
     */
     void setTimeout(uint32_t timeout_ms);
     
+    /**
+    * Discard the data buffered for a link
+    *
+    * @param id id of the link, valid 0-4
+    * @param datagram true if the link carries UDP datagrams
+    */
+    void clearLink(int id, bool datagram);
+    
 private:
     BufferedSerial serial;
     ATParser atParser;
+    uint32_t timeout;
+    
+    static const int numLinks = 5;
+    
+    /** Sender and unread length of a datagram in the buffer of a UDP link */
+    struct Datagram {
+        char ip[16];
+        uint16_t port;
+        uint16_t length;
+    };
+    
+    /** Data received on a link but not read yet */
+    struct Link {
+        bool open;
+        char buffer[ESP8266_RX_BUFFER_SIZE];
+        uint32_t head;
+        uint32_t count;
+        /** Set for UDP links, whose buffer holds whole datagrams in packets order */
+        bool datagram;
+        Datagram packets[ESP8266_DATAGRAM_QUEUE];
+        uint8_t packetHead;
+        uint8_t packetCount;
+    };
+    Link links[numLinks];
+    
+    /** Link being opened by openSocket, its CONNECT is not an incoming connection */
+    int openingID;
+    
+    /** Incoming connections in arrival order */
+    bool serverActive;
+    int backlog;
+    int pending[numLinks];
+    int pendingCount;
+    
+    /** Links refused because the backlog was full, closed from process() */
+    uint8_t rejected;
+    /** Set when a query was answered with "No AP" */
+    bool noAP;
+    /** Set when the last command was answered with "ERROR" or "DNS Fail" */
+    bool cmdError;
+    bool dnsFail;
+    /** Set when the AP connection changed, cleared by statusChanged() */
+    bool wifiChanged;
+    /** Set while a join started with startConnect runs, joinResult is its outcome */
+    bool joining;
+    int joinResult;
+    
+    /** Results of the last scan, strongest first, for the SSID in scanSSID or all APs */
+    esp8266_ap_t scanCache[ESP8266_SCAN_CACHE_SIZE];
+    int scanCount;
+    bool scanValid;
+    char scanSSID[33];
+    Timer scanAge;
+    uint32_t scanTTL;
+    
+    void packetHandler(const char *prefix);
+    void wifiHandler(const char *prefix);
+    void scanHandler(const char *prefix);
+    void abortHandler(const char *prefix);
+    void noAPHandler(const char *prefix);
+    void joinFailHandler(const char *prefix);
+    void dnsFailHandler(const char *prefix);
+    void closedHandler(const char *prefix);
+    void connectedHandler(const char *prefix);
 };
 
 #endif
@@ -16,14 +16,40 @@
 
 #include "ESP8266Interface.h"
 
-ESP8266Interface::ESP8266Interface(PinName tx, PinName rx) : esp8266(tx, rx)
+ESP8266Interface::ESP8266Interface(PinName tx, PinName rx) : esp8266(tx, rx), resolver(*this)
 {
     uuidCounter = 0;
-    std::fill_n(availableID, sizeof(availableID)/sizeof(int), -1);
+    useCounter = 0;
+    keepAlive = defaultKeepAlive;
+    nextLocalPort = firstLocalPort;
+    listenSlot = -1;
+    staticIP = false;
+    haveAP = false;
+    moduleDNS = -1;
+    connected = false;
+    ip[0] = gateway[0] = netmask[0] = mac[0] = 0;
+    rssi = 0;
+    probeDue = false;
+    probeInterval = defaultProbeInterval;
+    supervising = false;
+    linkDown = false;
+    rejoining = false;
+    downTotal = 0;
+    lostLinks = 0;
+    for(int i=0; i<numSlots; i++) {
+        slotHandle[i] = freeSlot;
+    }
+    for(int i=0; i<numSockets; i++) {
+        linkSlot[i] = -1;
+        pool[i].open = false;
+        pool[i].idle = false;
+        pool[i].localPort = 0;
+    }
 }
 
 int32_t ESP8266Interface::init(void)
 {
+    staticIP = false;
     if (!esp8266.startup()) {
         return -1;
     }
@@ -36,123 +62,727 @@ int32_t ESP8266Interface::init(void)
     if (!esp8266.multipleConnections(true)) {
         return -1;
     }
+    //Older firmware has no AT+CIPDINFO, datagrams then arrive without their sender
+    esp8266.remoteInfo(true);
+    //The MAC address never changes, so it is only read once
+    if (!esp8266.getMACAddress(mac)) {
+        mac[0] = 0;
+    }
+    refreshStatus();
     return 0;
 }
 
 int32_t ESP8266Interface::init(const char *ip, const char *mask, const char *gateway)
 {
-    return -1;
+    if (init() != 0) {
+        return -1;
+    }
+    //Setting the address stops DHCP, which saves the lease negotiation on every connect
+    if (!esp8266.setStaticIP(ip, gateway, mask)) {
+        return -1;
+    }
+    staticIP = true;
+    return 0;
 }
 
 int32_t ESP8266Interface::connect(uint32_t timeout_ms)
 {
+    esp8266.setTimeout(timeout_ms);
+    if (!staticIP && !esp8266.dhcp(1, true)) {
+        return -1;
+    }
+    char ap[33];
+    char bssid[18];
+    int channel;
+    if (esp8266.getAPInfo(ap, bssid, &channel)) {
+        //Already joined, the module rejoins the AP saved in its flash after a reset
+        refreshStatus();
+        startSupervision();
+        return 0;
+    }
+    if (haveAP) {
+        //Joining by BSSID skips the scan for the SSID
+        if (!esp8266.connect(lastAP, lastPassPhrase, lastBSSID)) {
+            return -1;
+        }
+        refreshStatus();
+        startSupervision();
+        return 0;
+    }
+    //Nothing to rejoin from here, wait for the module to join the AP saved in its flash
+    Timer timer;
+    timer.start();
+    while (timer.read_ms() < (int)timeout_ms) {
+        wait_ms(500);
+        if (esp8266.getAPInfo(ap, bssid, &channel)) {
+            refreshStatus();
+            startSupervision();
+            return 0;
+        }
+    }
     return -1;
 }
 
 int32_t ESP8266Interface::connect(const char *ap, const char *pass_phrase, wifi_security_t security, uint32_t timeout_ms)
 {
     esp8266.setTimeout(timeout_ms);
-    if (!esp8266.dhcp(1, true)) {
+    if (!staticIP && !esp8266.dhcp(1, true)) {
         return -1;
     }
-    if (!esp8266.connect(ap, pass_phrase)) {
+    if (!pass_phrase) {
+        pass_phrase = "";
+    }
+    bool joined = false;
+    if (haveAP && strcmp(ap, lastAP) == 0 && strcmp(pass_phrase, lastPassPhrase) == 0) {
+        joined = esp8266.connect(ap, pass_phrase, lastBSSID);
+    }
+    if (!joined && !esp8266.connect(ap, pass_phrase)) {
+        haveAP = false;
         return -1;
     }
+    rememberAP(ap, pass_phrase);
+    refreshStatus();
+    startSupervision();
     return 0;
 }
 
+void ESP8266Interface::rememberAP(const char *ap, const char *pass_phrase)
+{
+    haveAP = false;
+    if (strlen(ap) >= sizeof(lastAP) || strlen(pass_phrase) >= sizeof(lastPassPhrase)) {
+        return;
+    }
+    char joined[33];
+    if (!esp8266.getAPInfo(joined, lastBSSID, &lastChannel) || strcmp(joined, ap) != 0) {
+        return;
+    }
+    strcpy(lastAP, ap);
+    strcpy(lastPassPhrase, pass_phrase);
+    haveAP = true;
+}
+
 int32_t ESP8266Interface::disconnect(void)
 {
     if (!esp8266.disconnect()) {
         return -1;
     }
+    //Leaving on purpose is not an outage
+    probeTicker.detach();
+    supervising = false;
+    rejoining = false;
+    if (linkDown) {
+        downTotal += downTimer.read_ms();
+        downTimer.stop();
+        linkDown = false;
+    }
+    refreshStatus();
+    //Leaving the AP drops every link, pooled or not
     for(int i=0; i<numSockets; i++) {
-        SocketInterface *socket = sockets[availableID[i]];
-        deallocateSocket(socket);
+        pool[i].open = false;
+        pool[i].idle = false;
+    }
+    for(int i=0; i<numSlots; i++) {
+        if (slotHandle[i] != freeSlot) {
+            deallocateSocket(&socketSlots[i]);
+        }
     }
     return 0;
 }
 
-char *ESP8266Interface::getIPAddress(void)
+void ESP8266Interface::refreshStatus(void)
 {
-    if(!esp8266.getIPAddress(ip)) {
-        return NULL;
+    //Changes reported so far are covered by this query
+    esp8266.statusChanged();
+    char ap[33];
+    char bssid[18];
+    int channel;
+    int level;
+    connected = esp8266.getNetworkInfo(ip, gateway, netmask) && strcmp(ip, "0.0.0.0") != 0;
+    if (!connected) {
+        ip[0] = gateway[0] = netmask[0] = 0;
+        rssi = 0;
+        return;
+    }
+    rssi = esp8266.getAPInfo(ap, bssid, &channel, &level) ? level : 0;
+}
+
+void ESP8266Interface::updateStatus(void)
+{
+    //Only reads what the ESP8266 already sent, nothing is queried unless the connection changed
+    while (esp8266.process());
+    //Queries are answered with busy while the supervisor rejoins
+    if (!rejoining && esp8266.statusChanged()) {
+        refreshStatus();
     }
-    return ip;
+}
+
+char *ESP8266Interface::getIPAddress(void)
+{
+    updateStatus();
+    return connected ? ip : NULL;
 }
 
 char *ESP8266Interface::getGateway(void) const
 {
-    return 0;
+    return connected ? (char *)gateway : NULL;
 }
 
 char *ESP8266Interface::getNetworkMask(void) const
 {
-    return 0;
+    return connected ? (char *)netmask : NULL;
 }
 
 char *ESP8266Interface::getMACAddress(void) const
 {
-    return 0;
+    return mac[0] ? (char *)mac : NULL;
+}
+
+int32_t ESP8266Interface::getRSSI(void) const
+{
+    return rssi;
+}
+
+int32_t ESP8266Interface::scan(esp8266_ap_t *res, int count, const char *ssid, int minRSSI)
+{
+    return esp8266.scan(res, count, ssid, minRSSI);
 }
 
 int32_t ESP8266Interface::isConnected(void)
 {
-    return (getIPAddress() == NULL) ? -1 : 0;
+    updateStatus();
+    return connected ? 0 : -1;
+}
+
+void ESP8266Interface::setProbeInterval(uint32_t interval_ms)
+{
+    probeInterval = interval_ms;
+    probeTicker.detach();
+    if (supervising && probeInterval > 0) {
+        probeTicker.attach_us(this, &ESP8266Interface::probeTick, probeInterval * 1000);
+    }
+}
+
+void ESP8266Interface::startSupervision(void)
+{
+    if (supervising) {
+        return;
+    }
+    supervising = true;
+    probeDue = false;
+    setProbeInterval(probeInterval);
+}
+
+void ESP8266Interface::probeTick(void)
+{
+    probeDue = true;
+}
+
+void ESP8266Interface::supervise(void)
+{
+    if (!supervising) {
+        return;
+    }
+    if (rejoining) {
+        //Nothing else is sent to the ESP8266 until the join ends
+        int result = esp8266.connectResult();
+        if (result == 0 && (uint32_t)downTimer.read_ms() - joinStart < joinTimeout) {
+            return;
+        }
+        rejoining = false;
+        if (result > 0) {
+            refreshStatus();
+            if (connected) {
+                restoreLinks();
+                return;
+            }
+        }
+        nextAttempt = downTimer.read_ms() + backoff;
+        backoff = (backoff * 2 < maxBackoff) ? backoff * 2 : maxBackoff;
+        return;
+    }
+    if (probeDue) {
+        //An AP that vanishes without a WIFI DISCONNECT only shows up when asked
+        probeDue = false;
+        refreshStatus();
+    } else {
+        updateStatus();
+    }
+    if (connected) {
+        if (linkDown) {
+            restoreLinks();
+        }
+        return;
+    }
+    if (!linkDown) {
+        linkDown = true;
+        lostLinks = 0;
+        for(int i=0; i<numSockets; i++) {
+            if (pool[i].open && pool[i].addr[0]) {
+                lostLinks |= 1 << i;
+            }
+        }
+        downTimer.reset();
+        downTimer.start();
+        backoff = minBackoff;
+        nextAttempt = 0;
+    }
+    if ((uint32_t)downTimer.read_ms() < nextAttempt) {
+        return;
+    }
+    if (haveAP) {
+        //The join runs on the ESP8266, its result is read by the next calls
+        if (esp8266.startConnect(lastAP, lastPassPhrase, lastBSSID)) {
+            rejoining = true;
+            joinStart = downTimer.read_ms();
+            return;
+        }
+    } else {
+        //Nothing to rejoin from here, the module rejoins the AP saved in its flash
+        refreshStatus();
+        if (connected) {
+            restoreLinks();
+            return;
+        }
+    }
+    nextAttempt = downTimer.read_ms() + backoff;
+    backoff = (backoff * 2 < maxBackoff) ? backoff * 2 : maxBackoff;
+}
+
+void ESP8266Interface::restoreLinks(void)
+{
+    linkDown = false;
+    downTotal += downTimer.read_ms();
+    downTimer.stop();
+    for(int i=0; i<numSockets; i++) {
+        //A socket whose stream was dropped is told by poll() and recv(), a new
+        //connection under it would carry on in the middle of its exchange
+        if (!(lostLinks & (1 << i)) || !pool[i].open || !pool[i].idle || esp8266.isOpen(i)) {
+            continue;
+        }
+        string sock_type = (SOCK_UDP == pool[i].type) ? "UDP" : "TCP";
+        bool opened;
+        if (pool[i].localPort) {
+            opened = esp8266.openDatagram(i, pool[i].addr, pool[i].port, pool[i].localPort);
+        } else {
+            opened = esp8266.openSocket(sock_type, i, pool[i].port, pool[i].addr, (SOCK_TCP == pool[i].type) ? keepAlive : 0);
+        }
+        if (!opened) {
+            pool[i].open = false;
+            pool[i].idle = false;
+        }
+    }
+    lostLinks = 0;
+}
+
+uint32_t ESP8266Interface::getDisconnectedTime(void)
+{
+    return downTotal + (linkDown ? downTimer.read_ms() : 0);
 }
 
 SocketInterface *ESP8266Interface::allocateSocket(socket_protocol_t socketProtocol)
+{
+    reapClosedLinks();
+    int id = takeFreeLink(-1);
+    if (id == -1) {
+        return NULL;//tried to allocate more than the maximum 5 sockets
+    }
+    return allocateSlot(socketProtocol, (uint8_t)id);
+}
+
+int ESP8266Interface::takeFreeLink(int exclude)
 {
     int id = -1;
     //Look through the array of available sockets for an unused ID
     for(int i=0; i<numSockets; i++) {
-        if (availableID[i] == -1) {
+        if (i != exclude && linkSlot[i] == -1 && !pool[i].open && !esp8266.isOpen(i)) {
+            return i;
+        }
+    }
+    //All IDs are taken, evict the least recently used idle link
+    for(int i=0; i<numSockets; i++) {
+        if (i != exclude && linkSlot[i] == -1 && pool[i].open && (id == -1 || pool[i].lastUsed < pool[id].lastUsed)) {
             id = i;
-            availableID[i] = uuidCounter;
-            break;
         }
     }
-    if (id == -1) {
-        return NULL;//tried to allocate more than the maximum 5 sockets
+    if (id != -1) {
+        esp8266.close(id);
+        pool[id].open = false;
+        pool[id].idle = false;
+    }
+    return id;
+}
+
+ESP8266Socket *ESP8266Interface::allocateSlot(socket_protocol_t socketProtocol, uint8_t id)
+{
+    int slot = 0;
+    while (slot < numSlots && slotHandle[slot] != freeSlot) {
+        slot++;
+    }
+    if (slot == numSlots) {
+        return NULL;
     }
-    ESP8266Socket *socket = new ESP8266Socket(uuidCounter++, esp8266, socketProtocol, (uint8_t)id);
-    sockets[socket->getHandle()] = socket;
-    return socket;
+    uint32_t handle = uuidCounter++ * numSlots + slot;
+    socketSlots[slot] = ESP8266Socket(handle, *this, esp8266, socketProtocol, id);
+    slotHandle[slot] = handle;
+    linkSlot[id] = slot;
+    return &socketSlots[slot];
 }
 
 int ESP8266Interface::deallocateSocket(SocketInterface *socket)
 {
-    int id = (int)static_cast<ESP8266Socket*>(socket)->getID();
-    availableID[id] = -1;
+    // Check if socket is owned by this interface
+    if (socket == NULL) {
+        return -1;
+    }
+    ESP8266Socket *espSocket = findSocket(socket->getHandle());
+    if (espSocket != socket) {
+        return -1;
+    }
+    int slot = espSocket->getHandle() % numSlots;
+    if (slot == listenSlot || espSocket->getID() == noLink) {
+        closeLink(espSocket);
+        slotHandle[slot] = freeSlot;
+        return 0;
+    }
+    int id = (int)espSocket->getID();
+    linkSlot[id] = -1;
+    slotHandle[slot] = freeSlot;
+    
+    //A link left open is pooled or closed as if the socket had been closed
+    if (pool[id].open && !pool[id].idle) {
+        closeLink(espSocket);
+    }
+    return 0;
+}
+void ESP8266Interface::getHostByName(const char *name, char* hostIP)
+{
+    if (resolver.lookup(name, hostIP)) {
+        return;
+    }
+    if (moduleDNS != 0) {
+        //The module resolves in one AT round trip and needs no link
+        int result = esp8266.resolve(name, hostIP);
+        if (result == -3) {
+            //Not a hostname, no server would find it either
+            hostIP[0] = 0;
+            return;
+        }
+        if (result == 1) {
+            moduleDNS = 1;
+            resolver.store(name, hostIP, moduleDNSTTL);
+            return;
+        }
+        if (result == 0) {
+            moduleDNS = 1;
+        } else if (result == -1 && moduleDNS == -1) {
+            //Refused before it ever worked, the firmware does not have it
+            moduleDNS = 0;
+        }
+    }
+    //Without module DNS, or its servers failed, ask our own
+    if (!resolver.getHostByName(name, hostIP)) {
+        hostIP[0] = 0;
+    }
+}
 
-    std::map<uint32_t, SocketInterface*>::iterator it;
+DnsResolver &ESP8266Interface::getResolver(void)
+{
+    return resolver;
+}
 
-    // Check if socket is owned by WiFiRadioInterface
-    it = sockets.find(socket->getHandle());
+void ESP8266Interface::setKeepAlive(uint16_t keepalive_s)
+{
+    //The firmware accepts 1-7200 seconds
+    keepAlive = (keepalive_s > 7200) ? 7200 : keepalive_s;
+    if (keepAlive == 0) {
+        //Pooling disabled, drop the idle links nobody owns
+        for(int i=0; i<numSockets; i++) {
+            if (linkSlot[i] == -1 && pool[i].open) {
+                esp8266.close(i);
+                pool[i].open = false;
+                pool[i].idle = false;
+            }
+        }
+    }
+}
 
-    if (it != sockets.end()) {
-        // If so, erase it from the internal socket map and deallocate the socket
-        sockets.erase(it);
-        delete socket;
+int ESP8266Interface::findIdleLink(socket_protocol_t type, const char *addr, uint16_t port)
+{
+    for(int i=0; i<numSockets; i++) {
+        if (linkSlot[i] == -1 && pool[i].open && pool[i].idle &&
+            pool[i].type == type && pool[i].port == port && strcmp(pool[i].addr, addr) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ESP8266Socket *ESP8266Interface::findSocket(uint32_t handle)
+{
+    int slot = handle % numSlots;
+    if (slotHandle[slot] != handle) {
+        return NULL;
+    }
+    return &socketSlots[slot];
+}
+
+int32_t ESP8266Interface::poll(socket_poll_t *fds, uint32_t count, uint32_t timeout_ms)
+{
+    supervise();
+
+    Timer timer;
+    timer.start();
+
+    while (true) {
+        //Buffer whatever the ESP8266 has sent so the link states are current
+        while (esp8266.process());
+
+        int32_t ready = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (fds[i].socket == NULL) {
+                return -1;
+            }
+            ESP8266Socket *socket = findSocket(fds[i].socket->getHandle());
+            if (socket != fds[i].socket) {
+                return -1;
+            }
+            fds[i].revents = 0;
+            if ((int)(socket->getHandle() % numSlots) == listenSlot) {
+                //A listening socket is readable when a connection can be accepted
+                if ((fds[i].events & SOCK_POLLIN) && esp8266.pendingConnections()) {
+                    fds[i].revents |= SOCK_POLLIN;
+                    ready++;
+                }
+                continue;
+            }
+            int id = socket->getID();
+            if (id == noLink) {
+                continue;
+            }
+            if ((fds[i].events & SOCK_POLLIN) && esp8266.readable(id)) {
+                fds[i].revents |= SOCK_POLLIN;
+            }
+            if (pool[id].open && !pool[id].idle) {
+                if (!esp8266.isOpen(id)) {
+                    fds[i].revents |= SOCK_POLLHUP;
+                } else if (fds[i].events & SOCK_POLLOUT) {
+                    fds[i].revents |= SOCK_POLLOUT;
+                }
+            }
+            if (fds[i].revents) {
+                ready++;
+            }
+        }
+
+        if (ready || timer.read_ms() >= (int)timeout_ms) {
+            return ready;
+        }
+    }
+}
+
+void ESP8266Interface::reapClosedLinks(void)
+{
+    if (linkDown) {
+        //Pooled links dropped with the AP are re-opened by the supervisor
+        return;
+    }
+    for(int i=0; i<numSockets; i++) {
+        if (pool[i].open && pool[i].idle && !esp8266.isOpen(i)) {
+            pool[i].open = false;
+            pool[i].idle = false;
+        }
+    }
+}
+
+int32_t ESP8266Interface::openLink(ESP8266Socket *socket)
+{
+    reapClosedLinks();
+    int id = socket->getID();
+    if (id == noLink) {
+        return -1;
+    }
+    socket_protocol_t type = socket->getType();
+    const char *addr = socket->getAddress();
+    uint16_t port = socket->getPort();
+
+    if (pool[id].open) {
+        //Socket reopened to the endpoint its link is still connected to
+        if (pool[id].idle && pool[id].type == type && pool[id].port == port && strcmp(pool[id].addr, addr) == 0) {
+            //Data that arrived while the link was idle is not for this socket
+            esp8266.clearLink(id, false);
+            pool[id].idle = false;
+            return 0;
+        }
+        esp8266.close(id);
+        pool[id].open = false;
+    }
+
+    int idle = findIdleLink(type, addr, port);
+    if (idle != -1) {
+        //Take over the pooled link and give back the ID reserved at allocation
+        linkSlot[idle] = linkSlot[id];
+        linkSlot[id] = -1;
+        socket->setID((uint8_t)idle);
+        esp8266.clearLink(idle, false);
+        pool[idle].idle = false;
+        return 0;
+    }
+
+    string sock_type = (SOCK_UDP == type) ? "UDP" : "TCP";
+    if (!esp8266.openSocket(sock_type, id, port, addr, (SOCK_TCP == type) ? keepAlive : 0)) {
+        return -1;
+    }
+    pool[id].open = true;
+    pool[id].idle = false;
+    pool[id].type = type;
+    pool[id].port = port;
+    pool[id].localPort = 0;
+    //Endpoints too long to be keyed are never pooled
+    if (strlen(addr) < sizeof(pool[id].addr)) {
+        strcpy(pool[id].addr, addr);
     } else {
-        // Socket is not owned by WiFiRadioInterface, so return -1 error
+        pool[id].addr[0] = 0;
+    }
+    return 0;
+}
+
+int32_t ESP8266Interface::openDatagramLink(ESP8266Socket *socket, const char *addr, uint16_t port)
+{
+    int id = socket->getID();
+    if (id == noLink || SOCK_UDP != socket->getType()) {
         return -1;
     }
+    //A UDP link opened with open() can address each datagram as well
+    if (pool[id].open) {
+        return 0;
+    }
+    if (addr == NULL || strlen(addr) >= sizeof(pool[id].addr)) {
+        addr = "0.0.0.0";
+        port = 0;
+    }
+    uint16_t localPort = socket->getLocalPort();
+    if (localPort == 0) {
+        localPort = nextLocalPort;
+        nextLocalPort = (nextLocalPort == 0xFFFF) ? firstLocalPort : nextLocalPort + 1;
+    }
+    if (!esp8266.openDatagram(id, addr, port, localPort)) {
+        return -1;
+    }
+    pool[id].open = true;
+    pool[id].idle = false;
+    pool[id].type = SOCK_UDP;
+    pool[id].port = port;
+    pool[id].localPort = localPort;
+    strcpy(pool[id].addr, addr);
     return 0;
 }
-void ESP8266Interface::getHostByName(const char *name, char* hostIP)
+
+int32_t ESP8266Interface::closeLink(const ESP8266Socket *socket)
+{
+    if ((int)(socket->getHandle() % numSlots) == listenSlot) {
+        listenSlot = -1;
+        if (!esp8266.stopServer()) {
+            return -1;
+        }
+        return 0;
+    }
+    uint8_t id = socket->getID();
+    if (id == noLink) {
+        return 0;
+    }
+    if (SOCK_TCP == socket->getType() && keepAlive > 0 && pool[id].open && pool[id].addr[0]) {
+        //Keep the connection alive for the next socket to the same endpoint,
+        //without the data its last socket left unread
+        esp8266.clearLink(id, false);
+        pool[id].idle = true;
+        pool[id].lastUsed = ++useCounter;
+        return 0;
+    }
+    pool[id].open = false;
+    pool[id].idle = false;
+    if (!esp8266.close(id)) {
+        return -1;//closing socket not succesful
+    }
+    return 0;
+}
+
+int32_t ESP8266Interface::listenLink(ESP8266Socket *socket, uint32_t backlog)
 {
-    SocketInterface* sock = this->allocateSocket(SOCK_UDP);
-    DnsQuery dns(sock, name, hostIP);
-    this->deallocateSocket(sock);
-}   
+    //The ESP8266 runs a single TCP server
+    int id = socket->getID();
+    if (listenSlot != -1 || SOCK_TCP != socket->getType() || id == noLink || pool[id].open) {
+        return -1;
+    }
+    if (!esp8266.startServer(socket->getPort(), (int)backlog)) {
+        return -1;
+    }
+    //Connections arrive on links chosen by the ESP8266, so the listening
+    //socket gives its own link back
+    linkSlot[id] = -1;
+    socket->setID(noLink);
+    listenSlot = (int)(socket->getHandle() % numSlots);
+    return 0;
+}
 
-ESP8266Socket::ESP8266Socket(uint32_t handle, ESP8266 &driver, socket_protocol_t type, uint8_t id)
+SocketInterface *ESP8266Interface::acceptLink(ESP8266Socket *socket, uint32_t timeout_ms)
+{
+    if ((int)(socket->getHandle() % numSlots) != listenSlot) {
+        return NULL;
+    }
+    esp8266.setTimeout(timeout_ms);
+    int id = esp8266.accept();
+    if (id < 0) {
+        return NULL;
+    }
+    if (linkSlot[id] != -1) {
+        //The ESP8266 chose the ID reserved by a socket that is not open yet,
+        //move that socket to another ID before the connection takes this one
+        int other = takeFreeLink(id);
+        if (other == -1) {
+            esp8266.close(id);
+            return NULL;
+        }
+        linkSlot[other] = linkSlot[id];
+        linkSlot[id] = -1;
+        socketSlots[linkSlot[other]].setID((uint8_t)other);
+    }
+    ESP8266Socket *client = allocateSlot(SOCK_TCP, (uint8_t)id);
+    if (client == NULL) {
+        esp8266.close(id);
+        return NULL;
+    }
+    client->setPort(socket->getPort());
+    //Incoming connections have no endpoint to be pooled under
+    pool[id].open = true;
+    pool[id].idle = false;
+    pool[id].type = SOCK_TCP;
+    pool[id].port = socket->getPort();
+    pool[id].addr[0] = 0;
+    return client;
+}
+
+ESP8266Socket::ESP8266Socket()
+{
+    _handle = 0;
+    _interface = NULL;
+    _driver = NULL;
+    _type = SOCK_TCP;
+    _id = 0;
+    _addr = NULL;
+    _port = 0;
+    _localPort = 0;
+}
+
+ESP8266Socket::ESP8266Socket(uint32_t handle, ESP8266Interface &interface, ESP8266 &driver, socket_protocol_t type, uint8_t id)
 {
     _handle = handle;
+    _interface = &interface;
     _driver = &driver;
     _type = type;
     _id = id;
+    _addr = NULL;
+    _port = 0;
+    _localPort = 0;
 }
 
 const char *ESP8266Socket::getHostByName(const char *name) const
@@ -187,53 +817,123 @@ uint16_t ESP8266Socket::getPort(void) const
 }
 
 
-int32_t ESP8266Socket::bind(uint16_t port) const
+int32_t ESP8266Socket::bind(uint16_t port)
 {
-    return -1;
+    _port = port;
+    _localPort = port;
+    return 0;
 }
 
-int32_t ESP8266Socket::listen(void) const
+int32_t ESP8266Socket::listen(uint32_t backlog)
 {
-    return -1;
+    return _interface->listenLink(this, backlog);
 }
 
-int32_t ESP8266Socket::accept() const
+SocketInterface *ESP8266Socket::accept(uint32_t timeout_ms)
 {
-    return -1;
+    return _interface->acceptLink(this, timeout_ms);
 }
 
 int32_t ESP8266Socket::open()
 {
+    return _interface->openLink(this);
+}
+
+int32_t ESP8266Socket::send(const void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    socket_buffer_t buffer = {data, amount};
+    return sendv(&buffer, 1, timeout_ms);
+}
 
-    string sock_type = (SOCK_UDP == _type) ? "UDP" : "TCP";
-    if (!_driver->openSocket(sock_type, _id, _port, _addr)) {
+int32_t ESP8266Socket::sendv(const socket_buffer_t *buffers, uint32_t count, uint32_t timeout_ms)
+{
+    _driver->setTimeout((int)timeout_ms);
+    uint32_t amount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        amount += buffers[i].length;
+    }
+    //A datagram has to go out in one CIPSEND, a stream is split into as few as possible
+    if (amount == 0 || (SOCK_UDP == _type && amount > ESP8266_MAX_SEND)) {
         return -1;
     }
+
+    //The segments are streamed into the payload of each CIPSEND as they are
+    uint32_t segment = 0;
+    uint32_t offset = 0;
+    while (amount > 0) {
+        uint32_t block = (amount > ESP8266_MAX_SEND) ? ESP8266_MAX_SEND : amount;
+        if (!_driver->sendBegin(_id, block)) {
+            return -1;
+        }
+        for (uint32_t left = block; left > 0; ) {
+            uint32_t piece = buffers[segment].length - offset;
+            if (piece > left) {
+                piece = left;
+            }
+            if (piece > 0 && !_driver->sendWrite((const char*)buffers[segment].data + offset, piece)) {
+                return -1;
+            }
+            offset += piece;
+            left -= piece;
+            if (offset == buffers[segment].length) {
+                segment++;
+                offset = 0;
+            }
+        }
+        if (!_driver->sendEnd()) {
+            return -1;
+        }
+        amount -= block;
+    }
     return 0;
+}
 
+uint32_t ESP8266Socket::recv(void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    _driver->setTimeout((int)timeout_ms);
+    return _driver->recv(_id, data, amount);
 }
 
-int32_t ESP8266Socket::send(const void *data, uint32_t amount, uint32_t timeout_ms)
+int32_t ESP8266Socket::recvLend(const void **data, uint32_t timeout_ms)
+{
+    _driver->setTimeout((int)timeout_ms);
+    return (int32_t)_driver->recvLend(_id, data);
+}
+
+void ESP8266Socket::recvRelease(uint32_t amount)
+{
+    _driver->recvRelease(_id, amount);
+}
+
+int32_t ESP8266Socket::sendTo(const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms)
 {
+    if (SOCK_UDP != _type || addr == NULL) {
+        return -1;
+    }
     _driver->setTimeout((int)timeout_ms);
-    if(!_driver->sendData(_id, data, amount)) {
+    if (_interface->openDatagramLink(this, addr, port) < 0) {
+        return -1;
+    }
+    if(!_driver->sendData(_id, data, amount, addr, port)) {
         return -1;
     }
     return 0;
 }
 
-uint32_t ESP8266Socket::recv(void *data, uint32_t amount, uint32_t timeout_ms)
+uint32_t ESP8266Socket::recvFrom(char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms)
 {
+    if (SOCK_UDP == _type && _interface->openDatagramLink(this, NULL, 0) < 0) {
+        addr[0] = 0;
+        *port = 0;
+        return 0;
+    }
     _driver->setTimeout((int)timeout_ms);
-    return _driver->recv(data, amount);
+    return _driver->recvFrom(_id, addr, port, data, amount);
 }
 
 int32_t ESP8266Socket::close() const
 {
-    if (!_driver->close(_id)) {
-        return -1;//closing socket not succesful
-    }
-    return 0;
+    return _interface->closeLink(this);
 }
 
 uint32_t ESP8266Socket::getHandle()const
@@ -241,7 +941,22 @@ uint32_t ESP8266Socket::getHandle()const
     return _handle;
 }
 
-uint8_t ESP8266Socket::getID()
+uint8_t ESP8266Socket::getID() const
 {
     return _id;
 }
+
+void ESP8266Socket::setID(uint8_t id)
+{
+    _id = id;
+}
+
+socket_protocol_t ESP8266Socket::getType() const
+{
+    return _type;
+}
+
+uint16_t ESP8266Socket::getLocalPort() const
+{
+    return _localPort;
+}
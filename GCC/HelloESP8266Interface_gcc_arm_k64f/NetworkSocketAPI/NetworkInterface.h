@@ -19,7 +19,14 @@
 
 #include "stdint.h"
 #include "SocketInterface.h"
-#include <map>
+
+/** A socket to poll and the events of interest
+ */
+typedef struct {
+    SocketInterface *socket;    /*!< Socket to poll */
+    uint8_t events;             /*!< Requested socket_poll_event_t flags */
+    uint8_t revents;            /*!< Returned socket_poll_event_t flags */
+} socket_poll_t;
 
 /** NetworkInterface class.
     This is a common interface that is shared between all hardware that connect
@@ -92,10 +99,17 @@ public:
      */
     virtual int deallocateSocket(SocketInterface* socket) = 0;
     
-protected:
-    /** Map used to keep track of all SocketInterface instances */
-    std::map<uint32_t, SocketInterface*> sockets;
+    /** Wait until any of a set of sockets is ready.
+        SOCK_POLLHUP is reported whether requested or not.
+        @param fds Array of sockets and requested events, revents is set on return
+        @param count Number of entries in fds
+        @param timeout_ms Longest time to wait for an event, 0 to return immediately
+        @returns the number of sockets with events, 0 on timeout, a negative number on failure
+                 or if an entry has no socket or one of another interface
+     */
+    virtual int32_t poll(socket_poll_t *fds, uint32_t count, uint32_t timeout_ms = 15000) = 0;
     
+protected:
     /** Counter used to create unique handles for new sockets.
         Should be incremented whenever a new socket is created. 
      */
@@ -18,6 +18,7 @@
 #define SOCKETINTERFACE_H
 
 #include "stdint.h"
+#include "string.h"
 
 /** This enum defines the possible socket domain types.
  */
@@ -42,6 +43,21 @@ typedef enum {
     SOCK_UDP,    /*!< Socket connection over UDP */
 } socket_protocol_t;
 
+/** This enum defines the events that can be polled for on a socket
+ */
+typedef enum {
+    SOCK_POLLIN  = 0x1,  /*!< Data can be received without blocking */
+    SOCK_POLLOUT = 0x2,  /*!< Data can be sent without blocking */
+    SOCK_POLLHUP = 0x4,  /*!< Connection was closed by the remote host */
+} socket_poll_event_t;
+
+/** This struct describes one segment of a buffer chain
+ */
+typedef struct {
+    const void *data;   /*!< Start of the segment */
+    uint32_t length;    /*!< Number of bytes in the segment */
+} socket_buffer_t;
+
 /** Base class that defines an endpoint (TCP/UDP/Server/Client Socket)
  */
 class Endpoint
@@ -98,18 +114,20 @@ public:
         @param port The endpoint port
         @return 0 on success, -1 on failure (when an hostname cannot be resolved by DNS).
      */
-    virtual int32_t bind(uint16_t port) const = 0;
+    virtual int32_t bind(uint16_t port) = 0;
 
     /** In server mode, start listening to a port
-        @return 0 on success, -1 on failure (when an hostname cannot be resolved by DNS).
+        @param backlog The number of incoming connections queued until accepted
+        @return 0 on success, -1 on failure
      */
-    virtual int32_t listen(void) const = 0;
+    virtual int32_t listen(uint32_t backlog = 1) = 0;
 
     /** In server mode, accept an incoming connection
-        @param endpoint The endpoint we are listening to
-        @return 0 on success, -1 on failure (when an hostname cannot be resolved by DNS).
+        Waits for a connection when none is queued, readiness can be polled with SOCK_POLLIN.
+        @param timeout_ms The longest time to wait for a connection
+        @return a newly allocated socket for the connection, NULL on failure or timeout
      */
-    virtual int32_t accept() const = 0;
+    virtual SocketInterface *accept(uint32_t timeout_ms = 15000) = 0;
 
     /** In client mode, open a connection to a remote host
         @param endpoint The endpoint we want to connect to
@@ -133,6 +151,97 @@ public:
      */
     virtual uint32_t recv(void *data, uint32_t amount, uint32_t timeout_ms = 15000) = 0;
 
+    /** In client or server mode send a chain of buffers as one piece of data
+        Sockets that cannot gather the segments themselves send a copy.
+        @param buffers The segments to send, in order
+        @param count The number of segments
+        @param timeout_ms The longest amount of time this send can take
+        @return 0 on success, -1 on failure
+     */
+    virtual int32_t sendv(const socket_buffer_t *buffers, uint32_t count, uint32_t timeout_ms = 15000)
+    {
+        if (count == 1) {
+            return send(buffers[0].data, buffers[0].length, timeout_ms);
+        }
+        uint32_t amount = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            amount += buffers[i].length;
+        }
+        char *data = new char[amount];
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            memcpy(data + offset, buffers[i].data, buffers[i].length);
+            offset += buffers[i].length;
+        }
+        int32_t res = send(data, amount, timeout_ms);
+        delete[] data;
+        return res;
+    }
+
+    /** In client or server mode receive data without copying it
+        Lends out the received data in place, it stays valid until recvRelease
+        is called. Received data is handed out in order, a call may lend only
+        part of what is buffered.
+        @param data Set to the start of the received data
+        @param timeout_ms The longest time to wait for the data
+        @return The amount of data lent out, 0 on timeout, -1 if the socket
+                cannot lend its buffer
+     */
+    virtual int32_t recvLend(const void **data, uint32_t timeout_ms = 15000)
+    {
+        return -1;
+    }
+
+    /** Give back data lent out by recvLend
+        @param amount The amount of data that was consumed, at most the amount lent
+     */
+    virtual void recvRelease(uint32_t amount)
+    {
+    }
+
+    /** Send a datagram to a given endpoint, without opening a connection to it
+        Sockets that cannot address each datagram open a connection to the
+        endpoint when it changes.
+        @param addr The IP address of the endpoint
+        @param port The port of the endpoint
+        @param data A buffer of data to send
+        @param amount The amount of data to send
+        @param timeout_ms The longest amount of time this send can take
+        @return 0 on success, -1 on failure
+     */
+    virtual int32_t sendTo(const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms = 15000)
+    {
+        const char *current = getAddress();
+        if (current == NULL || strcmp(current, addr) != 0 || getPort() != port) {
+            setAddressPort(addr, port);
+            if (open() < 0) {
+                return -1;
+            }
+        }
+        return send(data, amount, timeout_ms);
+    }
+
+    /** Receive a datagram and the endpoint it came from
+        Sockets that cannot tell the sender report the endpoint they are open to.
+        @param addr Receives the IP address of the sender, 16 bytes, empty if unknown
+        @param port Receives the port of the sender, 0 if unknown
+        @param data a buffer to store the data in
+        @param amount The amount of data to receive, the rest of a longer datagram is dropped
+        @param timeout_ms The longest time to wait for the data
+        @return The amount of data received
+     */
+    virtual uint32_t recvFrom(char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms = 15000)
+    {
+        uint32_t received = recv(data, amount, timeout_ms);
+        const char *current = getAddress();
+        addr[0] = 0;
+        if (current != NULL && strlen(current) < 16) {
+            strcpy(addr, current);
+        }
+        *port = getPort();
+        return received;
+    }
+
     /** In client or server mode, close an open connection
         @param endpoint The endpoint we want to connect to
         @return 0 on success, -1 on failure (when an hostname cannot be resolved by DNS).
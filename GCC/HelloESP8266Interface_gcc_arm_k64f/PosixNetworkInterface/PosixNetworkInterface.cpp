@@ -0,0 +1,356 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __unix__
+
+#include "PosixNetworkInterface.h"
+#include "PosixSockets.h"
+#include <string.h>
+
+PosixNetworkInterface::PosixNetworkInterface()
+{
+    uuidCounter = 0;
+    for(int i=0; i<numSlots; i++) {
+        slotHandle[i] = freeSlot;
+    }
+    ip[0] = gateway[0] = netmask[0] = mac[0] = 0;
+}
+
+int32_t PosixNetworkInterface::init(void)
+{
+    return 0;
+}
+
+int32_t PosixNetworkInterface::init(const char *ip, const char *mask, const char *gateway)
+{
+    //The addresses of the host belong to the host
+    return -1;
+}
+
+int32_t PosixNetworkInterface::connect(uint32_t timeout_ms)
+{
+    return refreshStatus() ? 0 : -1;
+}
+
+int32_t PosixNetworkInterface::connect(const char *ap, const char *pass_phrase, wifi_security_t security, uint32_t timeout_ms)
+{
+    return connect(timeout_ms);
+}
+
+int32_t PosixNetworkInterface::disconnect(void)
+{
+    for(int i=0; i<numSlots; i++) {
+        if (slotHandle[i] != freeSlot) {
+            deallocateSocket(&socketSlots[i]);
+        }
+    }
+    return 0;
+}
+
+bool PosixNetworkInterface::refreshStatus(void)
+{
+    if (posix_interface_info(ip, netmask, gateway, mac) < 0) {
+        ip[0] = gateway[0] = netmask[0] = mac[0] = 0;
+        return false;
+    }
+    return true;
+}
+
+char *PosixNetworkInterface::getIPAddress(void)
+{
+    return refreshStatus() ? ip : NULL;
+}
+
+char *PosixNetworkInterface::getGateway(void) const
+{
+    return gateway[0] ? (char *)gateway : NULL;
+}
+
+char *PosixNetworkInterface::getNetworkMask(void) const
+{
+    return netmask[0] ? (char *)netmask : NULL;
+}
+
+char *PosixNetworkInterface::getMACAddress(void) const
+{
+    return mac[0] ? (char *)mac : NULL;
+}
+
+int32_t PosixNetworkInterface::isConnected(void)
+{
+    return refreshStatus() ? 0 : -1;
+}
+
+SocketInterface *PosixNetworkInterface::allocateSocket(socket_protocol_t socketProtocol)
+{
+    return allocateSlot(socketProtocol, -1);
+}
+
+PosixSocket *PosixNetworkInterface::allocateSlot(socket_protocol_t socketProtocol, int fd)
+{
+    int slot = 0;
+    while (slot < numSlots && slotHandle[slot] != freeSlot) {
+        slot++;
+    }
+    if (slot == numSlots) {
+        return NULL;
+    }
+    uint32_t handle = uuidCounter++ * numSlots + slot;
+    socketSlots[slot] = PosixSocket(handle, *this, socketProtocol, fd);
+    slotHandle[slot] = handle;
+    return &socketSlots[slot];
+}
+
+int PosixNetworkInterface::deallocateSocket(SocketInterface *socket)
+{
+    // Check if socket is owned by this interface
+    if (socket == NULL) {
+        return -1;
+    }
+    PosixSocket *posixSocket = findSocket(socket->getHandle());
+    if (posixSocket != socket) {
+        return -1;
+    }
+    closeSocket(posixSocket);
+    slotHandle[posixSocket->getHandle() % numSlots] = freeSlot;
+    return 0;
+}
+
+void PosixNetworkInterface::getHostByName(const char *name, char* hostIP)
+{
+    if (posix_gethostbyname(name, hostIP) < 0) {
+        hostIP[0] = 0;
+    }
+}
+
+PosixSocket *PosixNetworkInterface::findSocket(uint32_t handle)
+{
+    int slot = handle % numSlots;
+    if (slotHandle[slot] != handle) {
+        return NULL;
+    }
+    return &socketSlots[slot];
+}
+
+int32_t PosixNetworkInterface::poll(socket_poll_t *fds, uint32_t count, uint32_t timeout_ms)
+{
+    int pfds[numSlots];
+    uint8_t events[numSlots];
+    uint8_t revents[numSlots];
+    if (count > (uint32_t)numSlots) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (fds[i].socket == NULL) {
+            return -1;
+        }
+        PosixSocket *socket = findSocket(fds[i].socket->getHandle());
+        if (socket != fds[i].socket) {
+            return -1;
+        }
+        //Sockets without a descriptor are skipped by poll()
+        pfds[i] = socket->getFD();
+        events[i] = fds[i].events;
+    }
+    int ready = posix_poll(pfds, events, revents, count, timeout_ms);
+    if (ready < 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        fds[i].revents = revents[i];
+    }
+    return ready;
+}
+
+int32_t PosixNetworkInterface::closeSocket(const PosixSocket *socket)
+{
+    PosixSocket *posixSocket = findSocket(socket->getHandle());
+    if (posixSocket == NULL) {
+        return -1;
+    }
+    posix_close(posixSocket->getFD());
+    posixSocket->setFD(-1);
+    return 0;
+}
+
+SocketInterface *PosixNetworkInterface::acceptSocket(PosixSocket *socket, uint32_t timeout_ms)
+{
+    int fd = posix_accept(socket->getFD(), timeout_ms);
+    if (fd < 0) {
+        return NULL;
+    }
+    PosixSocket *client = allocateSlot(SOCK_TCP, fd);
+    if (client == NULL) {
+        posix_close(fd);
+        return NULL;
+    }
+    client->setPort(socket->getPort());
+    return client;
+}
+
+PosixSocket::PosixSocket()
+{
+    _handle = 0;
+    _interface = NULL;
+    _type = SOCK_TCP;
+    _fd = -1;
+    _addr = NULL;
+    _port = 0;
+}
+
+PosixSocket::PosixSocket(uint32_t handle, PosixNetworkInterface &interface, socket_protocol_t type, int fd)
+{
+    _handle = handle;
+    _interface = &interface;
+    _type = type;
+    _fd = fd;
+    _addr = NULL;
+    _port = 0;
+}
+
+const char *PosixSocket::getHostByName(const char *name) const
+{
+    return 0;
+}
+
+void PosixSocket::setAddress(const char* addr)
+{
+    _addr = addr;
+}
+
+void PosixSocket::setPort(uint16_t port)
+{
+    _port = port;
+}
+
+void PosixSocket::setAddressPort(const char* addr, uint16_t port)
+{
+    _addr = addr;
+    _port = port;
+}
+
+const char *PosixSocket::getAddress(void) const
+{
+    return _addr;
+}
+
+uint16_t PosixSocket::getPort(void) const
+{
+    return _port;
+}
+
+int32_t PosixSocket::bind(uint16_t port)
+{
+    if (_fd < 0) {
+        _fd = posix_socket(SOCK_UDP == _type);
+        if (_fd < 0) {
+            return -1;
+        }
+    }
+    _port = port;
+    return posix_bind(_fd, port);
+}
+
+int32_t PosixSocket::listen(uint32_t backlog)
+{
+    if (_fd < 0 || SOCK_TCP != _type) {
+        return -1;
+    }
+    return posix_listen(_fd, (int)backlog);
+}
+
+SocketInterface *PosixSocket::accept(uint32_t timeout_ms)
+{
+    if (_fd < 0) {
+        return NULL;
+    }
+    return _interface->acceptSocket(this, timeout_ms);
+}
+
+int32_t PosixSocket::open()
+{
+    //Reopening connects a fresh descriptor, like a new CIPSTART
+    if (_fd >= 0) {
+        _interface->closeSocket(this);
+    }
+    _fd = posix_socket(SOCK_UDP == _type);
+    if (_fd < 0) {
+        return -1;
+    }
+    return posix_connect(_fd, _addr, _port);
+}
+
+int32_t PosixSocket::send(const void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    return posix_send(_fd, data, amount, timeout_ms);
+}
+
+uint32_t PosixSocket::recv(void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    return posix_recv(_fd, data, amount, timeout_ms);
+}
+
+int32_t PosixSocket::sendTo(const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    if (SOCK_UDP != _type) {
+        return -1;
+    }
+    //An unbound UDP socket gets an ephemeral port from the first send
+    if (_fd < 0) {
+        _fd = posix_socket(true);
+        if (_fd < 0) {
+            return -1;
+        }
+    }
+    return posix_sendto(_fd, addr, port, data, amount, timeout_ms);
+}
+
+uint32_t PosixSocket::recvFrom(char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    if (_fd < 0) {
+        addr[0] = 0;
+        *port = 0;
+        return 0;
+    }
+    return posix_recvfrom(_fd, addr, port, data, amount, timeout_ms);
+}
+
+int32_t PosixSocket::close() const
+{
+    return _interface->closeSocket(this);
+}
+
+uint32_t PosixSocket::getHandle() const
+{
+    return _handle;
+}
+
+int PosixSocket::getFD() const
+{
+    return _fd;
+}
+
+void PosixSocket::setFD(int fd)
+{
+    _fd = fd;
+}
+
+socket_protocol_t PosixSocket::getType() const
+{
+    return _type;
+}
+
+#endif
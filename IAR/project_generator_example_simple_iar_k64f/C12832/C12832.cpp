@@ -16,12 +16,29 @@
 // 25.10.12    add autorefresh of screen
 // 25.10.12    add standart font
 // 20.12.12    add bitmap graphics
+// 19.10.26    only send changed columns to the lcd
+// 19.10.26    send pages with asynchronous spi
+// 19.10.26    add present() with a front buffer
+// 19.10.26    fill lines and rects by page bytes
+// 19.10.26    fill circles line by line
+// 19.10.26    take the lines of filled circles from the outline of circle()
+// 19.10.26    draw characters by page bytes, one update per printf
+// 19.10.26    add clip rows and flush_page() for the display list
+// 19.10.26    fill and blit of GraphicsDisplay without virtual pixel calls
+// 19.10.26    print bitmaps 8 rows at a time, clipped once
+// 19.10.26    add get_frame() and the host build
+// 19.10.26    send the page address of a background copy asynchronously too
+// 19.10.26    own printf, formatted into a buffer and sent with one update
 
 // optional defines :
 // #define debug_lcd  1
 
 #include "C12832.h"
+#ifdef C12832_HOST
+#include "LCDHost.h"
+#else
 #include "mbed.h"
+#endif
 #include "stdio.h"
 #include "Small_7.h"
 
@@ -29,11 +46,20 @@
 
 
 C12832::C12832(PinName mosi, PinName sck, PinName reset, PinName a0, PinName ncs, const char* name)
-    : _spi(mosi,NC,sck),_reset(reset),_A0(a0),_CS(ncs),GraphicsDisplay(name)
+    : _spi(mosi,NC,sck),_reset(reset),_A0(a0),_CS(ncs),GraphicsDisplayT<C12832, 128, 32>(name)
 {
     orientation = 1;
     draw_mode = NORMAL;
     char_x = 0;
+    clip_y0 = 0;
+    clip_y1 = 31;
+    for (int page = 0; page < 4; page++) {
+        dirty_x0[page] = 128;
+        dirty_x1[page] = 0;
+    }
+#if DEVICE_SPI_ASYNCH
+    copy_page_nr = -1;
+#endif
     lcd_reset();
 }
 
@@ -75,6 +101,7 @@ unsigned int C12832::get_contrast(void)
 
 void C12832::wr_cmd(unsigned char cmd)
 {
+    wait_copy();
     _A0 = 0;
     _CS = 0;
     _spi.write(cmd);
@@ -83,8 +110,21 @@ void C12832::wr_cmd(unsigned char cmd)
 
 // write data to lcd controller
 
+// set column and page address
+
+void C12832::wr_addr(int page, int x)
+{
+    _A0 = 0;
+    _CS = 0;
+    _spi.write(0x00 | (x & 0x0F));   // set column low nibble
+    _spi.write(0x10 | (x >> 4));     // set column hi  nibble
+    _spi.write(0xB0 | page);         // set page address
+    _CS = 1;
+}
+
 void C12832::wr_dat(unsigned char dat)
 {
+    wait_copy();
     _A0 = 1;
     _CS = 0;
     _spi.write(dat);
@@ -98,6 +138,9 @@ void C12832::lcd_reset()
 
     _spi.format(8,3);                 // 8 bit spi mode 3
     _spi.frequency(20000000);          // 19,2 Mhz SPI clock
+#if DEVICE_SPI_ASYNCH
+    _spi.set_dma_usage(DMA_USAGE_OPPORTUNISTIC);
+#endif
     _A0 = 0;
     _CS = 1;
     _reset = 0;                        // display reset
@@ -127,6 +170,7 @@ void C12832::lcd_reset()
 
     // clear and update LCD
     memset(buffer,0x00,512);  // clear display buffer
+    for (int page = 0; page < 4; page++) mark_dirty(page, 0, 127);
     copy_to_lcd();
     auto_up = 1;              // switch on auto update
     // dont do this by default. Make the user call
@@ -140,7 +184,9 @@ void C12832::lcd_reset()
 void C12832::pixel(int x, int y, int color)
 {
     // first check parameter
-    if(x > 128 || y > 32 || x < 0 || y < 0) return;
+    if(x > 127 || y > clip_y1 || x < 0 || y < clip_y0) return;
+
+    mark_dirty(y/8, x, x);
 
     if(draw_mode == NORMAL) {
         if(color == 0)
@@ -153,57 +199,199 @@ void C12832::pixel(int x, int y, int color)
     }
 }
 
-// update lcd
+// pixels written by fill and blit of GraphicsDisplay
+
+void C12832::changed(int x0, int y0, int x1, int y1)
+{
+    for(int page = y0 >> 3; page <= y1 >> 3; page++) mark_dirty(page, x0, x1);
+}
+
+// mark a column range of a page for the next update
+
+void C12832::mark_dirty(int page, int x0, int x1)
+{
+    if(x0 < dirty_x0[page]) dirty_x0[page] = x0;
+    if(x1 > dirty_x1[page]) dirty_x1[page] = x1;
+}
+
+// update lcd, page by page only the changed columns
+
+#if DEVICE_SPI_ASYNCH
 
 void C12832::copy_to_lcd(void)
 {
-    
-    int i=0;
-    
-    //page 0
-    wr_cmd(0x00);      // set column low nibble 0
-    wr_cmd(0x10);      // set column hi  nibble 0
-    wr_cmd(0xB0);      // set page address  0
-    _A0 = 1;
-    for(i=0; i<128; i++) {
-        wr_dat(buffer[i]);
+    int page;
+
+    wait_copy();
+    for(page=0; page<4; page++) {
+        copy_x0[page] = dirty_x0[page];
+        copy_x1[page] = dirty_x1[page];
+        if(copy_x0[page] <= copy_x1[page])
+            memcpy(&front[page*128 + copy_x0[page]], &buffer[page*128 + copy_x0[page]], copy_x1[page] - copy_x0[page] + 1);
+        dirty_x0[page] = 128;
+        dirty_x1[page] = 0;
     }
+    copy_page_nr = 0;
+    copy_page();
+}
 
-    // page 1
-    wr_cmd(0x00);      // set column low nibble 0
-    wr_cmd(0x10);      // set column hi  nibble 0
-    wr_cmd(0xB1);      // set page address  1
-    _A0 = 1;
-    for(i=128; i<256; i++) {
-        wr_dat(buffer[i]);
+void C12832::flush_page(int page)
+{
+    int p;
+
+    wait_copy();
+    for(p=0; p<4; p++) {
+        copy_x0[p] = 128;
+        copy_x1[p] = 0;
+    }
+    copy_x0[page] = dirty_x0[page];
+    copy_x1[page] = dirty_x1[page];
+    if(copy_x0[page] <= copy_x1[page])
+        memcpy(&front[page*128 + copy_x0[page]], &buffer[page*128 + copy_x0[page]], copy_x1[page] - copy_x0[page] + 1);
+    dirty_x0[page] = 128;
+    dirty_x1[page] = 0;
+    copy_page_nr = page;
+    copy_page();
+}
+
+void C12832::copy_page(void)
+{
+    // skip unchanged pages
+    while(copy_page_nr < 4 && copy_x0[copy_page_nr] > copy_x1[copy_page_nr]) copy_page_nr++;
+    if(copy_page_nr == 4) {
+        copy_page_nr = -1;
+        return;
     }
 
-    //page 2
-    wr_cmd(0x00);      // set column low nibble 0
-    wr_cmd(0x10);      // set column hi  nibble 0
-    wr_cmd(0xB2);      // set page address  2
+    // the address goes out as a transfer of its own, nothing here waits for the spi
+    int page = copy_page_nr;
+    copy_addr[0] = 0x00 | (copy_x0[page] & 0x0F);   // set column low nibble
+    copy_addr[1] = 0x10 | (copy_x0[page] >> 4);     // set column hi  nibble
+    copy_addr[2] = 0xB0 | page;                     // set page address
+    _A0 = 0;
+    _CS = 0;                           // CS stays low for the address and the page
+    _spi.transfer(copy_addr, 3, (uint8_t*)NULL, 0, event_callback_t(this, &C12832::copy_addr_done));
+}
+
+void C12832::copy_addr_done(int event)
+{
+    int page = copy_page_nr;
     _A0 = 1;
-    for(i=256; i<384; i++) {
-        wr_dat(buffer[i]);
+    _spi.transfer(&front[page*128 + copy_x0[page]], copy_x1[page] - copy_x0[page] + 1,
+                  (uint8_t*)NULL, 0, event_callback_t(this, &C12832::copy_done));
+}
+
+void C12832::copy_done(int event)
+{
+    _CS = 1;
+    copy_page_nr++;
+    copy_page();
+}
+
+// sleep until the copy has finished, the interrupt of the last page wakes the cpu
+// the check runs with interrupts off, so that interrupt can not slip in before __WFI
+
+void C12832::wait_copy(void)
+{
+    __disable_irq();
+    while(copy_page_nr >= 0) {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
     }
+    __enable_irq();
+}
+
+unsigned int C12832::get_busy(void)
+{
+    return (copy_page_nr >= 0);
+}
+
+#else
+
+void C12832::copy_to_lcd(void)
+{
+    int page;
+
+    for(page=0; page<4; page++) flush_page(page);
+}
+
+void C12832::flush_page(int page)
+{
+    int i;
 
-    //page 3
-    wr_cmd(0x00);      // set column low nibble 0
-    wr_cmd(0x10);      // set column hi  nibble 0
-    wr_cmd(0xB3);      // set page address  3
+    if(dirty_x0[page] > dirty_x1[page]) return;   // page unchanged
+
+    wr_addr(page, dirty_x0[page]);
     _A0 = 1;
+    _CS = 0;                           // CS stays low for the whole page
+    for(i=page*128 + dirty_x0[page]; i<=page*128 + dirty_x1[page]; i++) {
+        front[i] = buffer[i];
+        _spi.write(front[i]);
+    }
+    _CS = 1;
 
-    _CS = 0;
-    
-    for(i=384; i<512; i++) {
-        wr_dat(buffer[i]);
+    dirty_x0[page] = 128;
+    dirty_x1[page] = 0;
+}
+
+void C12832::wait_copy(void)
+{
+}
+
+unsigned int C12832::get_busy(void)
+{
+    return 0;
+}
+
+#endif
+
+// send the difference between framebuffer and lcd
+
+void C12832::present(void)
+{
+    int page,x0,x1;
+
+    wait_copy();
+    for(page=0; page<4; page++) {
+        unsigned char* b = &buffer[page*128];
+        unsigned char* f = &front[page*128];
+        x0 = 0;
+        x1 = 127;
+        while(x0 <= 127 && b[x0] == f[x0]) x0++;
+        while(x1 > x0 && b[x1] == f[x1]) x1--;
+        if(x0 > 127) {
+            dirty_x0[page] = 128;      // page unchanged
+            dirty_x1[page] = 0;
+        } else {
+            dirty_x0[page] = x0;
+            dirty_x1[page] = x1;
+        }
     }
+    copy_to_lcd();
+}
+
+// read the framebuffer or the lcd content row by row
 
+void C12832::get_frame(unsigned char* image, int lcd)
+{
+    const unsigned char* src = lcd ? front : buffer;
+    int x,y;
+
+    wait_copy();
+    memset(image, 0x00, 512);
+    for(y=0; y<32; y++) {
+        for(x=0; x<128; x++) {
+            if(src[(y/8) * 128 + x] & (1 << (y%8)))
+                image[y*16 + x/8] |= 0x80 >> (x%8);
+        }
+    }
 }
 
 void C12832::cls(void)
 {
     memset(buffer,0x00,512);  // clear display buffer
+    for (int page = 0; page < 4; page++) mark_dirty(page, 0, 127);
     copy_to_lcd();
 }
 
@@ -218,22 +406,24 @@ void C12832::line(int x0, int y0, int x1, int y1, int color)
     dx = x1-x0;
     dy = y1-y0;
 
-    //  if (dx == 0) {        /* vertical line */
-    //      if (y1 > y0) vline(x0,y0,y1,color);
-    //      else vline(x0,y1,y0,color);
-    //      return;
-    //  }
+    if (dx == 0) {        /* vertical line */
+        if (y1 > y0) vline(x0,y0,y1,color);
+        else vline(x0,y1,y0,color);
+        if(auto_up) copy_to_lcd();
+        return;
+    }
 
     if (dx > 0) {
         dx_sym = 1;
     } else {
         dx_sym = -1;
     }
-    //  if (dy == 0) {        /* horizontal line */
-    //      if (x1 > x0) hline(x0,x1,y0,color);
-    //      else  hline(x1,x0,y0,color);
-    //      return;
-    //  }
+    if (dy == 0) {        /* horizontal line */
+        if (x1 > x0) hline(x0,x1,y0,color);
+        else  hline(x1,x0,y0,color);
+        if(auto_up) copy_to_lcd();
+        return;
+    }
 
     if (dy > 0) {
         dy_sym = 1;
@@ -298,7 +488,7 @@ void C12832::rect(int x0, int y0, int x1, int y1, int color)
 
 void C12832::fillrect(int x0, int y0, int x1, int y1, int color)
 {
-    int l,c,i;
+    int i;
     if(x0 > x1) {
         i = x0;
         x0 = x1;
@@ -311,15 +501,89 @@ void C12832::fillrect(int x0, int y0, int x1, int y1, int color)
         y1 = i;
     }
 
-    for(l = x0; l<= x1; l ++) {
-        for(c = y0; c<= y1; c++) {
-            pixel(l,c,color);
-        }
-    }
+    // clip to the screen
+    if(x0 < 0) x0 = 0;
+    if(x1 > 127) x1 = 127;
+    if(y0 < clip_y0) y0 = clip_y0;
+    if(y1 > clip_y1) y1 = clip_y1;
+
+    if(x0 <= x1 && y0 <= y1) fill_area(x0, y0, x1, y1, color);
     if(auto_up) copy_to_lcd();
 }
 
+// fill a clipped rect, page by page
+
+void C12832::fill_area(int x0, int y0, int x1, int y1, int color)
+{
+    int page;
+    unsigned char mask;
+
+    for(page = y0 >> 3; page <= y1 >> 3; page++) {
+        mask = 0xFF;
+        if(page == y0 >> 3) mask &= 0xFF << (y0 & 7);      // rows above y0
+        if(page == y1 >> 3) mask &= 0xFF >> (7 - (y1 & 7)); // rows below y1
+        fill_span(page, x0, x1, mask, color);
+    }
+}
+
+void C12832::hline(int x0, int x1, int y, int color)
+{
+    if(y < clip_y0 || y > clip_y1) return;
+    if(x0 < 0) x0 = 0;
+    if(x1 > 127) x1 = 127;
+    if(x0 > x1) return;
+    fill_span(y >> 3, x0, x1, 1 << (y & 7), color);
+}
+
+void C12832::vline(int x, int y0, int y1, int color)
+{
+    int page;
+    unsigned char mask;
+    if(x < 0 || x > 127) return;
+    if(y0 < clip_y0) y0 = clip_y0;
+    if(y1 > clip_y1) y1 = clip_y1;
+    for(page = y0 >> 3; page <= y1 >> 3 && y0 <= y1; page++) {
+        mask = 0xFF;
+        if(page == y0 >> 3) mask &= 0xFF << (y0 & 7);
+        if(page == y1 >> 3) mask &= 0xFF >> (7 - (y1 & 7));
+        fill_span(page, x, x, mask, color);
+    }
+}
+
+// rows of a page inside the clip rows, bit 0 is the top row
 
+unsigned char C12832::clip_mask(int page)
+{
+    int top = clip_y0 - page*8;
+    int bottom = clip_y1 - page*8;
+    if(top > 7 || bottom < 0) return 0;
+    if(top < 0) top = 0;
+    if(bottom > 7) bottom = 7;
+    return (0xFF << top) & (0xFF >> (7 - bottom));
+}
+
+// change the masked rows of columns x0-x1 of a page, the range is already clipped
+
+void C12832::fill_span(int page, int x0, int x1, unsigned char mask, int color)
+{
+    unsigned char* p = &buffer[page*128 + x0];
+    int n = x1 - x0 + 1;
+
+    if(draw_mode == NORMAL) {
+        if(mask == 0xFF) {
+            memset(p, color ? 0xFF : 0x00, n);                 // whole bytes
+        } else if(color == 0) {
+            mask = ~mask;
+            while(n--) *p++ &= mask;                            // erase rows
+        } else {
+            while(n--) *p++ |= mask;                            // set rows
+        }
+    } else { // XOR mode
+        if(color != 1) return;
+        while(n--) *p++ ^= mask;
+    }
+    mark_dirty(page, x0, x1);
+}
 
 void C12832::circle(int x0, int y0, int r, int color)
 {
@@ -431,15 +695,40 @@ void C12832::circle(int x0, int y0, int r, int color)
 
 void C12832::fillcircle(int x, int y, int r, int color)
 {
-    int i,up;
-    up = auto_up;
-    auto_up = 0;   // off
-    for (i = 0; i <= r; i++)
-        circle(x,y,i,color);
-    auto_up = up;
+    int xx,yy,di;
+    if (r <= 0) return;               /* no radius, like circle() */
+
+    // walk the octant of circle() from (0,r) on; each outline point (xx,yy)
+    // ends the line yy of the top octant and gives the half width yy to the
+    // line xx of the side octant. The one or two lines where the octants
+    // meet are filled after the walk, so every pixel is drawn once
+    di = 3 - 2*r;
+    xx = 0;
+    yy = r;
+    while (xx < yy) {
+        if (yy - xx > 1 || di < 0) fill_lines(x, y, xx, yy, color);
+        if (di < 0) {
+            di += 4*xx + 6;
+        } else {
+            if (yy - xx > 1) fill_lines(x, y, yy, xx, color);
+            di += 4*(xx - yy) + 10;
+            yy--;
+        }
+        xx++;
+    }
+    fill_lines(x, y, yy, xx, color);
+    if (xx != yy) fill_lines(x, y, xx, yy, color);
     if(auto_up) copy_to_lcd();
 }
 
+// the lines dy above and below the center, 2*w + 1 pixel wide
+
+void C12832::fill_lines(int x, int y, int dy, int w, int color)
+{
+    hline(x - w, x + w, y + dy, color);
+    if (dy > 0) hline(x - w, x + w, y - dy, color);
+}
+
 void C12832::setmode(int mode)
 {
     draw_mode = mode;
@@ -482,11 +771,50 @@ int C12832::_putc(int value)
     return value;
 }
 
+// write a whole string with a single update of the screen
+
+// printf of Stream goes through stdio, which may call write() for every
+// char of an unbuffered stream, so the text is formatted here and drawn
+// with a single update of the screen
+
+int C12832::printf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+int C12832::vprintf(const char* format, va_list args)
+{
+    char buffer[C12832_PRINTF_SIZE];
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    if (n < 0) return n;
+    if (n >= (int)sizeof(buffer)) n = sizeof(buffer) - 1;
+    write(buffer, n);
+    return n;
+}
+
+ssize_t C12832::write(const void* data, size_t length)
+{
+    const char* p = (const char*)data;
+    unsigned int up = auto_up;
+    auto_up = 0;
+    for (size_t n = 0; n < length; n++) {
+        _putc(p[n]);
+    }
+    auto_up = up;
+    if(auto_up) copy_to_lcd();
+    return length;
+}
+
 void C12832::character(int x, int y, int c)
 {
-    unsigned int hor,vert,offset,bpl,j,i,b;
+    unsigned int hor,vert,offset,bpl,i,k;
     unsigned char* zeichen;
-    unsigned char z,w;
+    unsigned int bits,cell,v,m;
+    int cx,page,row;
 
     if ((c < 31) || (c > 127)) return;   // test char range
 
@@ -505,22 +833,44 @@ void C12832::character(int x, int y, int c)
     }
 
     zeichen = &font[((c -32) * offset) + 4]; // start of char bitmap
-    w = zeichen[0];                          // width of actual char
-    // construct the char into the buffer
-    for (j=0; j<vert; j++) {  //  vert line
-        for (i=0; i<hor; i++) {   //  horz line
-            z =  zeichen[bpl * i + ((j & 0xF8) >> 3)+1];
-            b = 1 << (j & 0x07);
-            if (( z & b ) == 0x00) {
-                pixel(x+i,y+j,0);
+
+    // the font stores each column top down in bytes like the pages of the lcd,
+    // so a column is shifted to the row of the char and masked into the pages
+    cell = (vert >= 32) ? 0xFFFFFFFF : (1u << vert) - 1;  // rows of the char cell
+    for (i=0; i<hor; i++) {
+        cx = x + i;
+        if (cx < 0 || cx > 127) continue;
+        bits = 0;
+        for (k=0; k<bpl && k<4; k++) {
+            bits |= (unsigned int)zeichen[bpl * i + k + 1] << (8 * k);
+        }
+        for (page=0; page<4; page++) {
+            row = page*8 - y;                // row of the char at the top of the page
+            if (row <= -8 || row >= (int)vert) continue;
+            if (row >= 0) {
+                v = bits >> row;
+                m = cell >> row;
             } else {
-                pixel(x+i,y+j,1);
+                v = bits << -row;
+                m = cell << -row;
+            }
+            m &= clip_mask(page);
+            if (draw_mode == NORMAL) {
+                buffer[page*128 + cx] = (buffer[page*128 + cx] & ~m) | (v & m);
+            } else { // XOR mode
+                buffer[page*128 + cx] ^= v & m;
             }
-
         }
     }
 
-    char_x += w;
+    // columns and pages covered by the char cell
+    int x0 = (x < 0) ? 0 : x;
+    int x1 = (x + (int)hor - 1 > 127) ? 127 : x + (int)hor - 1;
+    for (page=0; page<4 && x0<=x1; page++) {
+        if (page*8 + 7 >= y && page*8 < y + (int)vert && clip_mask(page)) mark_dirty(page, x0, x1);
+    }
+
+    char_x += zeichen[0];                    // width of actual char
 }
 
 
@@ -540,25 +890,74 @@ unsigned int C12832::get_auto_up(void)
     return (auto_up);
 }
 
+// transpose 8 bitmap rows, msb left, into 8 lcd columns, bit 0 on top
+
+static void rows_to_columns(const unsigned char* row, unsigned char* col)
+{
+    unsigned int a,b,t;
+
+    // bottom row in the high byte, so bit 0 of each column is the top row
+    a = (row[7] << 24) | (row[6] << 16) | (row[5] << 8) | row[4];
+    b = (row[3] << 24) | (row[2] << 16) | (row[1] << 8) | row[0];
+
+    t = (a ^ (a >> 7)) & 0x00AA00AA;
+    a = a ^ t ^ (t << 7);
+    t = (b ^ (b >> 7)) & 0x00AA00AA;
+    b = b ^ t ^ (t << 7);
+    t = (a ^ (a >> 14)) & 0x0000CCCC;
+    a = a ^ t ^ (t << 14);
+    t = (b ^ (b >> 14)) & 0x0000CCCC;
+    b = b ^ t ^ (t << 14);
+    t = (a & 0xF0F0F0F0) | ((b >> 4) & 0x0F0F0F0F);
+    b = ((a << 4) & 0xF0F0F0F0) | (b & 0x0F0F0F0F);
+    a = t;
+
+    col[0] = a >> 24;
+    col[1] = a >> 16;
+    col[2] = a >> 8;
+    col[3] = a;
+    col[4] = b >> 24;
+    col[5] = b >> 16;
+    col[6] = b >> 8;
+    col[7] = b;
+}
+
 void C12832::print_bm(Bitmap bm, int x, int y)
 {
-    int h,v,b;
-    char d;
-
-    for(v=0; v < bm.ySize; v++) {   // lines
-        for(h=0; h < bm.xSize; h++) { // pixel
-            if(h + x > 127) break;
-            if(v + y > 31) break;
-            d = bm.data[bm.Byte_in_Line * v + ((h & 0xF8) >> 3)];
-            b = 0x80 >> (h & 0x07);
-            if((d & b) == 0) {
-                pixel(x+h,y+v,0);
-            } else {
-                pixel(x+h,y+v,1);
+    int x0,x1,y0,y1,page,sx,k,i,cx;
+    unsigned char row[8],col[8],m;
+    unsigned char* p;
+
+    // clip once to the screen and the clip rows
+    x0 = (x < 0) ? 0 : x;
+    x1 = (x + bm.xSize - 1 > 127) ? 127 : x + bm.xSize - 1;
+    y0 = (y < clip_y0) ? clip_y0 : y;
+    y1 = (y + bm.ySize - 1 > clip_y1) ? clip_y1 : y + bm.ySize - 1;
+    if(x0 > x1 || y0 > y1) return;
+
+    for(page = y0 >> 3; page <= y1 >> 3; page++) {
+        m = 0xFF;
+        if(page == y0 >> 3) m &= 0xFF << (y0 & 7);      // rows above y0
+        if(page == y1 >> 3) m &= 0xFF >> (7 - (y1 & 7)); // rows below y1
+
+        // each source byte gives 8 columns of the page
+        for(sx = (x0 - x) >> 3; sx <= (x1 - x) >> 3; sx++) {
+            for(k=0; k<8; k++) {
+                row[k] = (m & (1 << k)) ? bm.data[bm.Byte_in_Line * (page*8 + k - y) + sx] : 0;
+            }
+            rows_to_columns(row, col);
+
+            cx = x + sx*8;
+            for(i=0; i<8; i++) {
+                if(cx + i < x0 || cx + i > x1) continue;
+                p = &buffer[page*128 + cx + i];
+                if(draw_mode == NORMAL) {
+                    *p = (*p & ~m) | (col[i] & m);
+                } else { // XOR mode
+                    *p ^= col[i] & m;
+                }
             }
         }
+        mark_dirty(page, x0, x1);
     }
-
 }
-
-
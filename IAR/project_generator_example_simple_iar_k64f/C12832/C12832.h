@@ -15,25 +15,22 @@
 #ifndef C12832_H
 #define C12832_H
 
+#ifdef C12832_HOST
+#include "LCDHost.h"
+#else
 #include "mbed.h"
+#endif
 #include "GraphicsDisplay.h"
+#include <stdarg.h>
 
 
 /** optional Defines :
   * #define debug_lcd  1  enable infos to PC_USB
+  * #define C12832_PRINTF_SIZE  size of the printf buffer on the stack
   */
-
-// some defines for the DMA use
-#define DMA_CHANNEL_ENABLE      1
-#define DMA_TRANSFER_TYPE_M2P   (1UL << 11)
-#define DMA_CHANNEL_TCIE        (1UL << 31)
-#define DMA_CHANNEL_SRC_INC     (1UL << 26)
-#define DMA_MASK_IE             (1UL << 14)
-#define DMA_MASK_ITC            (1UL << 15)
-#define DMA_SSP1_TX             (1UL << 2)
-#define DMA_SSP0_TX             (0)
-#define DMA_DEST_SSP1_TX        (2UL << 6)
-#define DMA_DEST_SSP0_TX        (0UL << 6)
+#ifndef C12832_PRINTF_SIZE
+#define C12832_PRINTF_SIZE 128
+#endif
 
 /** Draw mode
   * NORMAl
@@ -50,8 +47,11 @@ struct Bitmap{
     char* data;
     };
 
-class C12832 : public GraphicsDisplay
+class C12832 : public GraphicsDisplayT<C12832, 128, 32>
 {
+    friend class DisplayList;
+    friend class GraphicsDisplayT<C12832, 128, 32>;
+
 public:
     /** Create a C12832 object connected to SPI1
       *
@@ -98,8 +98,8 @@ public:
      * @param r radius
      * @param color ,1 set pixel ,0 erase pixel
      *
-     * use circle with different radius,
-     * can miss some pixel
+     * filled line by line inside the outline of circle(), every pixel
+     * is drawn once. r = 0 draws nothing
      */
     void fillcircle(int x, int y, int r, int colour);
 
@@ -132,10 +132,35 @@ public:
 
     /** copy display buffer to lcd
       *
+      * only the columns changed since the last copy are sent
+      * on targets with asynchronous SPI the copy runs in the background,
+      * each page is sent by DMA or interrupt while the program continues
       */
 
     void copy_to_lcd(void);
 
+    /** show the frame drawn since the last update
+      *
+      * the framebuffer is compared with the lcd content and only the
+      * changed bytes are sent, so objects erased and redrawn in place
+      * cost nothing. Use with auto update switched off to draw a whole
+      * frame before it is shown, without flicker.
+      */
+    void present(void);
+
+    /** copy the screen into an image
+      *
+      * @param image 32 rows of 16 bytes, msb is the left pixel, 1 = pixel set
+      * @param lcd 0 = framebuffer, 1 = content sent to the lcd
+      */
+    void get_frame(unsigned char* image, int lcd = 0);
+
+    /** get status of the background copy
+      *
+      * @returns 1 while copy_to_lcd is still sending, 0 when done
+      */
+    unsigned int get_busy(void);
+
     /** set the orienation of the screen
       *
       */
@@ -185,6 +210,25 @@ public:
      */
     virtual int _putc(int value);
 
+    /** print formatted text at the cursor
+     *
+     * @param format printf format string
+     * @returns number of chars printed
+     *
+     * the text is formatted into a buffer and drawn in one piece, with
+     * auto update on the screen is updated once at the end. Text longer
+     * than C12832_PRINTF_SIZE - 1 chars is cut off
+     */
+    int printf(const char* format, ...);
+
+    /** print formatted text at the cursor, like printf
+     *
+     * @param format printf format string
+     * @param args arguments of the format
+     * @returns number of chars printed
+     */
+    int vprintf(const char* format, va_list args);
+
     /** draw a character on given position out of the active font to the LCD
      *
      * @param x x-position of char (top left)
@@ -245,12 +289,21 @@ public:
       * @param x  x start
       * @param y  y start 
       *
+      * the bitmap is clipped to the screen, rows are msb first.
+      * NORMAL copies the bitmap, XOR inverts the pixels set in it.
       */
 
     void print_bm(Bitmap bm, int x, int y);
 
 protected:
 
+    /** write a string to the screen, used by printf and puts
+      *
+      * with auto update on the screen is updated once at the end
+      *
+      */
+    virtual ssize_t write(const void* data, size_t length);
+
     /** draw a horizontal line
       *
       * @param x0 horizontal start
@@ -261,6 +314,15 @@ protected:
       */
     void hline(int x0, int x1, int y, int colour);
 
+    /** draw the two lines of a filled circle at the same distance from the center
+      *
+      * @param x,y center
+      * @param dy distance of the lines from the center, 0 draws one line
+      * @param w half width of the lines
+      * @param ,1 set pixel ,0 erase pixel
+      */
+    void fill_lines(int x, int y, int dy, int w, int colour);
+
     /** draw a vertical line
      *
      * @param x horizontal position
@@ -268,7 +330,48 @@ protected:
      * @param y1 vertical stop
      * @param ,1 set pixel ,0 erase pixel
      */
-    void vline(int y0, int y1, int x, int colour);
+    void vline(int x, int y0, int y1, int colour);
+
+    /** write a pixel for fill and blit of GraphicsDisplay
+      *
+      * @param x horizontal position, inside the screen
+      * @param y vertical position, inside the screen
+      * @param colour ,0 erase pixel, else set pixel
+      */
+    void put_pixel(int x, int y, int colour) {
+        unsigned char* p = &buffer[x + ((y >> 3) * 128)];
+        if(draw_mode == NORMAL) {
+            if(colour == 0) *p &= ~(1 << (y & 7));
+            else *p |= (1 << (y & 7));
+        } else if(colour == 1) {
+            *p ^= (1 << (y & 7));
+        }
+    }
+
+    /** fill a rect inside the screen by page bytes
+      *
+      * @param x0,y0 top left corner
+      * @param x1,y1 down right corner
+      * @param colour ,1 set pixel ,0 erase pixel
+      */
+    void fill_area(int x0, int y0, int x1, int y1, int colour);
+
+    /** mark the pixels written by fill or blit of GraphicsDisplay
+      *
+      * @param x0,y0 top left corner
+      * @param x1,y1 down right corner
+      */
+    void changed(int x0, int y0, int x1, int y1);
+
+    /** set or erase the same rows in a run of columns of one page
+     *
+     * @param page page 0-3
+     * @param x0 first column
+     * @param x1 last column
+     * @param mask rows of the page to change, bit 0 is the top row
+     * @param colour ,1 set pixel ,0 erase pixel
+     */
+    void fill_span(int page, int x0, int x1, unsigned char mask, int colour);
 
     /** Init the C12832 LCD controller
      *
@@ -291,10 +394,76 @@ protected:
 
     void wr_cnt(unsigned char cmd);
 
+    /** set the column and page address for the following data
+      *
+      * @param page page 0-3
+      * @param x column
+      */
+    void wr_addr(int page, int x);
+
+    /** wait until a background copy has finished
+      *
+      */
+    void wait_copy(void);
+
+#if DEVICE_SPI_ASYNCH
+    /** start sending the next page of a background copy
+      *
+      */
+    void copy_page(void);
+
+    /** SPI event of a background copy, the page address was sent
+      *
+      */
+    void copy_addr_done(int event);
+
+    /** SPI event of a background copy, a page was sent
+      *
+      */
+    void copy_done(int event);
+
+    // page being sent, -1 if no copy is running
+    volatile int copy_page_nr;
+    // column ranges taken over from dirty_x0/dirty_x1 by copy_to_lcd
+    unsigned char copy_x0[4];
+    unsigned char copy_x1[4];
+    // column and page address of the page being sent
+    unsigned char copy_addr[3];
+#endif
+
+    /** send the changed columns of one page to the lcd
+      *
+      * @param page page 0-3
+      */
+    void flush_page(int page);
+
+    /** rows of a page inside the clip rows
+      *
+      * @param page page 0-3
+      * @returns mask of the rows, bit 0 is the top row
+      */
+    unsigned char clip_mask(int page);
+
+    /** mark columns of a page as changed, copy_to_lcd sends them
+      *
+      * @param page page 0-3, 8 pixel rows each
+      * @param x0 first changed column
+      * @param x1 last changed column
+      */
+    void mark_dirty(int page, int x0, int x1);
+
     unsigned int orientation;
     unsigned int char_x;
     unsigned int char_y;
     unsigned char buffer[512];
+    // content of the lcd ram, sent from here so that drawing can go on during a copy
+    unsigned char front[512];
+    // changed columns of each page, dirty_x0 > dirty_x1 if the page is unchanged
+    unsigned char dirty_x0[4];
+    unsigned char dirty_x1[4];
+    // drawing is limited to the rows clip_y0 - clip_y1, 0 - 31 by default
+    int clip_y0;
+    int clip_y1;
     unsigned int contrast;
     unsigned int auto_up;
 
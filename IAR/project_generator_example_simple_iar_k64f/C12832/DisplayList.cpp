@@ -0,0 +1,175 @@
+/* mbed library for the mbed Lab Board  128*32 pixel LCD
+ * display list for the C12832
+ * Released under the MIT License: http://mbed.org/license/mit
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "DisplayList.h"
+#include "string.h"
+
+enum {
+    DL_MODE,
+    DL_LINE,
+    DL_RECT,
+    DL_FILLRECT,
+    DL_CIRCLE,
+    DL_FILLCIRCLE,
+    DL_TEXT,
+    DL_BITMAP
+};
+
+DisplayList::DisplayList()
+{
+    length = 0;
+}
+
+void DisplayList::clear(void)
+{
+    length = 0;
+}
+
+int DisplayList::used(void)
+{
+    return length;
+}
+
+// pages of the rows y0 - y1, 0 if they are off the screen
+
+unsigned char DisplayList::page_mask(int y0, int y1)
+{
+    int i;
+    if(y0 > y1) {
+        i = y0;
+        y0 = y1;
+        y1 = i;
+    }
+    if(y1 < 0 || y0 > 31) return 0;
+    if(y0 < 0) y0 = 0;
+    if(y1 > 31) y1 = 31;
+    return (0x0F << (y0 >> 3)) & (0x0F >> (3 - (y1 >> 3)));
+}
+
+int DisplayList::add(int op, unsigned char pages, int colour, int a, int b, int c, int d, const void* data, int size)
+{
+    if(pages == 0) return 0;                     // nothing to draw
+    if(size > 255) return -1;
+
+    int n = (sizeof(command) + size + 3) & ~3;   // keep the next header aligned
+    if(length + n > (int)sizeof(arena)) return -1;
+
+    command* cmd = (command*)((unsigned char*)arena + length);
+    cmd->op = op;
+    cmd->pages = pages;
+    cmd->colour = colour;
+    cmd->size = size;
+    cmd->a = a;
+    cmd->b = b;
+    cmd->c = c;
+    cmd->d = d;
+    if(size) memcpy(cmd + 1, data, size);
+    length += n;
+    return 0;
+}
+
+int DisplayList::setmode(int mode)
+{
+    return add(DL_MODE, 0x0F, 0, mode, 0, 0, 0, NULL, 0);
+}
+
+int DisplayList::line(int x0, int y0, int x1, int y1, int colour)
+{
+    return add(DL_LINE, page_mask(y0, y1), colour, x0, y0, x1, y1, NULL, 0);
+}
+
+int DisplayList::rect(int x0, int y0, int x1, int y1, int colour)
+{
+    return add(DL_RECT, page_mask(y0, y1), colour, x0, y0, x1, y1, NULL, 0);
+}
+
+int DisplayList::fillrect(int x0, int y0, int x1, int y1, int colour)
+{
+    return add(DL_FILLRECT, page_mask(y0, y1), colour, x0, y0, x1, y1, NULL, 0);
+}
+
+int DisplayList::circle(int x, int y, int r, int colour)
+{
+    return add(DL_CIRCLE, page_mask(y - r, y + r), colour, x, y, r, 0, NULL, 0);
+}
+
+int DisplayList::fillcircle(int x, int y, int r, int colour)
+{
+    return add(DL_FILLCIRCLE, page_mask(y - r, y + r), colour, x, y, r, 0, NULL, 0);
+}
+
+int DisplayList::text(int x, int y, const char* s)
+{
+    // line feeds and wrapping can move the text to any page
+    return add(DL_TEXT, 0x0F, 0, x, y, 0, 0, s, strlen(s));
+}
+
+int DisplayList::print_bm(Bitmap bm, int x, int y)
+{
+    return add(DL_BITMAP, page_mask(y, y + bm.ySize - 1), 0, x, y, 0, 0, &bm, sizeof(bm));
+}
+
+// run the commands of each page clipped to the page, then send the page
+
+void DisplayList::draw(C12832& lcd)
+{
+    unsigned int up = lcd.auto_up;
+    unsigned int mode = lcd.draw_mode;
+    int page,pos,i;
+    command* cmd;
+    Bitmap bm;
+
+    lcd.auto_up = 0;
+    for(page=0; page<4; page++) {
+        lcd.clip_y0 = page*8;
+        lcd.clip_y1 = page*8 + 7;
+        lcd.draw_mode = mode;
+        for(pos=0; pos<length; pos += (sizeof(command) + cmd->size + 3) & ~3) {
+            cmd = (command*)((unsigned char*)arena + pos);
+            if((cmd->pages & (1 << page)) == 0) continue;
+            switch(cmd->op) {
+                case DL_MODE:
+                    lcd.setmode(cmd->a);
+                    break;
+                case DL_LINE:
+                    lcd.line(cmd->a, cmd->b, cmd->c, cmd->d, cmd->colour);
+                    break;
+                case DL_RECT:
+                    lcd.rect(cmd->a, cmd->b, cmd->c, cmd->d, cmd->colour);
+                    break;
+                case DL_FILLRECT:
+                    lcd.fillrect(cmd->a, cmd->b, cmd->c, cmd->d, cmd->colour);
+                    break;
+                case DL_CIRCLE:
+                    lcd.circle(cmd->a, cmd->b, cmd->c, cmd->colour);
+                    break;
+                case DL_FILLCIRCLE:
+                    lcd.fillcircle(cmd->a, cmd->b, cmd->c, cmd->colour);
+                    break;
+                case DL_TEXT:
+                    lcd.locate(cmd->a, cmd->b);
+                    for(i=0; i<cmd->size; i++) lcd._putc(((char*)(cmd + 1))[i]);
+                    break;
+                case DL_BITMAP:
+                    memcpy(&bm, cmd + 1, sizeof(bm));
+                    lcd.print_bm(bm, cmd->a, cmd->b);
+                    break;
+            }
+        }
+        if(up) lcd.flush_page(page);
+    }
+    lcd.clip_y0 = 0;
+    lcd.clip_y1 = 31;
+    lcd.draw_mode = mode;
+    lcd.auto_up = up;
+}
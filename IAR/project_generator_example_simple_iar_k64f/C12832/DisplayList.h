@@ -0,0 +1,162 @@
+/* mbed library for the mbed Lab Board  128*32 pixel LCD
+ * display list for the C12832
+ * Released under the MIT License: http://mbed.org/license/mit
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include "C12832.h"
+
+/** size of the command memory of a display list in bytes
+  * a line, rect or circle takes 12 bytes, text 12 bytes + the string
+  */
+#ifndef DISPLAY_LIST_SIZE
+#define DISPLAY_LIST_SIZE 256
+#endif
+
+/** A display list records drawing commands and draws them later
+  *
+  * draw() renders the screen page by page: each page only runs the
+  * commands that touch it, clipped to its 8 rows, and is sent to the
+  * lcd as soon as it is complete. On targets with asynchronous SPI the
+  * next page is drawn while the last one is sent.
+  *
+  * The commands keep their order, so XOR and erase work like
+  * drawing directly. A list can be drawn again until clear() is called.
+  */
+class DisplayList
+{
+public:
+    /** Create an empty display list
+      *
+      */
+    DisplayList();
+
+    /** remove all commands
+      *
+      */
+    void clear(void);
+
+    /** draw the list to the framebuffer of the lcd
+      *
+      * @param lcd display to draw to
+      * with auto update on, each page is sent to the lcd when drawn,
+      * otherwise the program calls copy_to_lcd() or present().
+      * The drawing mode of the lcd is the same afterwards.
+      */
+    void draw(C12832& lcd);
+
+    /** get the number of bytes used
+      *
+      * @returns used bytes of DISPLAY_LIST_SIZE
+      */
+    int used(void);
+
+    /** record a change of the drawing mode
+      *
+      * @param mode NORMAl or XOR
+      * @returns 0 on success, -1 if the list is full
+      */
+    int setmode(int mode);
+
+    /** record a 1 pixel line
+      *
+      * @param x0,y0 start point
+      * @param x1,y1 stop point
+      * @param colour ,1 set pixel ,0 erase pixel
+      * @returns 0 on success, -1 if the list is full
+      */
+    int line(int x0, int y0, int x1, int y1, int colour);
+
+    /** record a rect
+      *
+      * @param x0,y0 top left corner
+      * @param x1,y1 down right corner
+      * @param colour 1 set pixel ,0 erase pixel
+      * @returns 0 on success, -1 if the list is full
+      */
+    int rect(int x0, int y0, int x1, int y1, int colour);
+
+    /** record a filled rect
+      *
+      * @param x0,y0 top left corner
+      * @param x1,y1 down right corner
+      * @param colour 1 set pixel ,0 erase pixel
+      * @returns 0 on success, -1 if the list is full
+      */
+    int fillrect(int x0, int y0, int x1, int y1, int colour);
+
+    /** record a circle
+      *
+      * @param x,y center
+      * @param r radius
+      * @param colour ,1 set pixel ,0 erase pixel
+      * @returns 0 on success, -1 if the list is full
+      */
+    int circle(int x, int y, int r, int colour);
+
+    /** record a filled circle
+      *
+      * @param x,y center
+      * @param r radius
+      * @param colour ,1 set pixel ,0 erase pixel
+      * @returns 0 on success, -1 if the list is full
+      */
+    int fillcircle(int x, int y, int r, int colour);
+
+    /** record a string in the font of the lcd
+      *
+      * @param x,y position of the first char (top left)
+      * @param s string, copied into the list, up to 255 chars
+      * @returns 0 on success, -1 if the list is full
+      */
+    int text(int x, int y, const char* s);
+
+    /** record a bitmap
+      *
+      * @param bm Bitmap in flash, the data is not copied
+      * @param x  x start
+      * @param y  y start
+      * @returns 0 on success, -1 if the list is full
+      */
+    int print_bm(Bitmap bm, int x, int y);
+
+protected:
+
+    /** command header, followed by size bytes of data
+      *
+      */
+    struct command {
+        unsigned char op;
+        unsigned char pages;    // bit n is set if the command touches page n
+        unsigned char colour;
+        unsigned char size;
+        short a, b, c, d;
+    };
+
+    /** add a command to the list
+      *
+      * @returns 0 on success, -1 if the list is full
+      */
+    int add(int op, unsigned char pages, int colour, int a, int b, int c, int d, const void* data, int size);
+
+    /** pages touched by the rows y0 - y1
+      *
+      */
+    static unsigned char page_mask(int y0, int y1);
+
+    // command memory, int for the alignment of the headers
+    unsigned int arena[DISPLAY_LIST_SIZE / 4];
+    int length;
+};
+
+#endif
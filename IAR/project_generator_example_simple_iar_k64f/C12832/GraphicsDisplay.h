@@ -52,4 +52,97 @@ protected:
 
 };
 
+/** GraphicsDisplay with the size and pixel format known at compile time
+ *
+ * Derive the display as class T : public GraphicsDisplayT<T, width, height>
+ * and implement
+ *   void put_pixel(int x, int y, int colour)   - write a pixel inside the screen, inline
+ * and if needed
+ *   void fill_area(int x0, int y0, int x1, int y1, int colour) - fill a clipped rect
+ *   void changed(int x0, int y0, int x1, int y1) - called once per fill or blit
+ * fill, blit, blitbit and cls clip once and call put_pixel directly,
+ * so the loops are compiled for the pixel format of the display
+ * instead of one virtual pixel() call per pixel.
+ */
+template <class T, int W, int H>
+class GraphicsDisplayT : public GraphicsDisplay {
+
+public:
+
+    GraphicsDisplayT(const char* name) : GraphicsDisplay(name) {}
+
+    virtual int width() { return W; }
+    virtual int height() { return H; }
+
+    virtual void pixel(int x, int y, int colour) {
+        if(x < 0 || x >= W || y < 0 || y >= H) return;
+        display()->put_pixel(x, y, colour);
+        display()->changed(x, y, x, y);
+    }
+
+    virtual void fill(int x, int y, int w, int h, int colour) {
+        int x0, y0, x1, y1;
+        window(x, y, w, h);
+        if(!clip(x, y, w, h, x0, y0, x1, y1)) return;
+        display()->fill_area(x0, y0, x1, y1, colour);
+        display()->changed(x0, y0, x1, y1);
+    }
+
+    virtual void blit(int x, int y, int w, int h, const int *colour) {
+        int x0, y0, x1, y1;
+        window(x, y, w, h);
+        if(!clip(x, y, w, h, x0, y0, x1, y1)) return;
+        for(int j = y0; j <= y1; j++) {
+            const int *line = colour + (j - y) * w;
+            for(int i = x0; i <= x1; i++) {
+                display()->put_pixel(i, j, line[i - x]);
+            }
+        }
+        display()->changed(x0, y0, x1, y1);
+    }
+
+    virtual void blitbit(int x, int y, int w, int h, const char* colour) {
+        int x0, y0, x1, y1;
+        window(x, y, w, h);
+        if(!clip(x, y, w, h, x0, y0, x1, y1)) return;
+        for(int j = y0; j <= y1; j++) {
+            for(int i = x0; i <= x1; i++) {
+                int k = (j - y) * w + (i - x);      // bit of the source, msb first
+                display()->put_pixel(i, j, (colour[k >> 3] & (0x80 >> (k & 7))) ? _foreground : _background);
+            }
+        }
+        display()->changed(x0, y0, x1, y1);
+    }
+
+    virtual void cls() {
+        fill(0, 0, W, H, _background);
+    }
+
+protected:
+
+    // default fill pixel by pixel, displays can write whole bytes or words
+    void fill_area(int x0, int y0, int x1, int y1, int colour) {
+        for(int j = y0; j <= y1; j++) {
+            for(int i = x0; i <= x1; i++) {
+                display()->put_pixel(i, j, colour);
+            }
+        }
+    }
+
+    // default for displays that need no notice of changed pixels
+    void changed(int x0, int y0, int x1, int y1) {}
+
+    T* display() { return static_cast<T*>(this); }
+
+    // clip a window to the screen, false if nothing is left
+    static bool clip(int x, int y, int w, int h, int &x0, int &y0, int &x1, int &y1) {
+        x0 = (x < 0) ? 0 : x;
+        y0 = (y < 0) ? 0 : y;
+        x1 = (x + w > W) ? W - 1 : x + w - 1;
+        y1 = (y + h > H) ? H - 1 : y + h - 1;
+        return x0 <= x1 && y0 <= y1;
+    }
+
+};
+
 #endif
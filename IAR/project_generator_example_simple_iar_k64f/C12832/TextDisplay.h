@@ -16,7 +16,11 @@
 #ifndef MBED_TEXTDISPLAY_H
 #define MBED_TEXTDISPLAY_H
 
+#ifdef C12832_HOST
+#include "LCDHost.h"
+#else
 #include "mbed.h"
+#endif
 
 class TextDisplay : public Stream {
 public:
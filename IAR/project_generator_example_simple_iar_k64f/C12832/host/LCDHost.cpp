@@ -0,0 +1,150 @@
+/* mbed library for the mbed Lab Board  128*32 pixel LCD
+ * host build of the display library
+ * Released under the MIT License: http://mbed.org/license/mit
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifdef C12832_HOST
+
+#include "LCDHost.h"
+
+unsigned long host_spi_bytes = 0;
+
+int Stream::printf(const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (n < 0) {
+        return n;
+    }
+    if (n >= (int)sizeof(buffer)) {
+        n = sizeof(buffer) - 1;
+    }
+    write(buffer, n);
+    return n;
+}
+
+ssize_t Stream::write(const void* buffer, size_t length)
+{
+    const char* p = (const char*)buffer;
+    for (size_t i = 0; i < length; i++) {
+        _putc(p[i]);
+    }
+    return length;
+}
+
+// png needs a crc for each chunk and an adler32 for the zlib stream
+
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t length)
+{
+    crc = ~crc;
+    while (length--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void put32(unsigned char* p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static bool write_chunk(FILE* f, const char* type, const unsigned char* data, size_t length)
+{
+    unsigned char head[8];
+    unsigned char tail[4];
+    put32(head, length);
+    memcpy(head + 4, type, 4);
+    put32(tail, crc32(crc32(0, head + 4, 4), data, length));
+    return fwrite(head, 1, 8, f) == 8
+        && (length == 0 || fwrite(data, 1, length, f) == length)
+        && fwrite(tail, 1, 4, f) == 4;
+}
+
+int host_write_png(const char* file, const unsigned char* image, int width, int height)
+{
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    int stride = (width + 7) / 8;
+    size_t raw = (size_t)height * (stride + 1);
+
+    // the pixel rows are stored uncompressed, in deflate blocks of up to 65535 bytes
+    size_t blocks = (raw + 65534) / 65535;
+    size_t size = 2 + raw + 5 * (blocks ? blocks : 1) + 4;
+    unsigned char* idat = new unsigned char[size];
+    unsigned char* p = idat;
+    uint32_t a = 1, b = 0;
+
+    *p++ = 0x78;                                // zlib header, no compression
+    *p++ = 0x01;
+    size_t done = 0;
+    int y = 0, x = -1;                          // x == -1 is the filter byte of a row
+    do {
+        size_t n = raw - done > 65535 ? 65535 : raw - done;
+        *p++ = (done + n == raw) ? 1 : 0;       // last block
+        *p++ = n;
+        *p++ = n >> 8;
+        *p++ = ~n;
+        *p++ = ~n >> 8;
+        for (size_t i = 0; i < n; i++) {
+            unsigned char c;
+            if (x < 0) {
+                c = 0;                          // filter type none
+            } else {
+                c = ~image[y * stride + x];     // png gray, 0 is black
+            }
+            if (++x == stride) {
+                x = -1;
+                y++;
+            }
+            *p++ = c;
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+        done += n;
+    } while (done < raw);
+    put32(p, (b << 16) | a);
+    p += 4;
+
+    unsigned char ihdr[13];
+    put32(ihdr, width);
+    put32(ihdr + 4, height);
+    ihdr[8] = 1;                                // 1 bit per pixel
+    ihdr[9] = 0;                                // gray
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    int result = -1;
+    FILE* f = fopen(file, "wb");
+    if (f) {
+        if (fwrite(signature, 1, 8, f) == 8
+                && write_chunk(f, "IHDR", ihdr, 13)
+                && write_chunk(f, "IDAT", idat, p - idat)
+                && write_chunk(f, "IEND", NULL, 0)) {
+            result = 0;
+        }
+        if (fclose(f) != 0) {
+            result = -1;
+        }
+    }
+    delete[] idat;
+    return result;
+}
+
+#endif
@@ -0,0 +1,99 @@
+/* mbed library for the mbed Lab Board  128*32 pixel LCD
+ * host build of the display library
+ * Released under the MIT License: http://mbed.org/license/mit
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// With C12832_HOST defined the display library includes this file instead
+// of mbed.h. SPI and DigitalOut are stubs, the SPI stub counts the bytes
+// sent, so drawing can be tested and profiled without the lcd.
+
+#ifndef LCDHOST_H
+#define LCDHOST_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** pin names of the Arduino header
+ */
+typedef enum {
+    D0, D1, D2, D3, D4, D5, D6, D7,
+    D8, D9, D10, D11, D12, D13, D14, D15,
+    NC = -1
+} PinName;
+
+/** bytes sent by all SPI stubs
+ */
+extern unsigned long host_spi_bytes;
+
+/** SPI master stub, the data goes nowhere
+ */
+class SPI {
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk) {}
+    void format(int bits, int mode = 0) {}
+    void frequency(int hz = 1000000) {}
+    int write(int value) {
+        host_spi_bytes++;
+        return 0;
+    }
+};
+
+/** digital output stub
+ */
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : _value(0) {}
+    void write(int value) { _value = value; }
+    int read() { return _value; }
+    DigitalOut& operator= (int value) {
+        _value = value;
+        return *this;
+    }
+    operator int() { return _value; }
+
+protected:
+    int _value;
+};
+
+/** Stream with putc and printf, output goes to write() or _putc()
+ */
+class Stream {
+public:
+    Stream(const char *name = NULL) {}
+    virtual ~Stream() {}
+
+    int putc(int c) { return _putc(c); }
+    int printf(const char* format, ...);
+
+protected:
+    virtual ssize_t write(const void* buffer, size_t length);
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+};
+
+inline void wait(float s) {}
+inline void wait_ms(int ms) {}
+inline void wait_us(int us) {}
+
+/** write a 1 bit image as png file
+ *
+ * @param file name of the file
+ * @param image rows of (width + 7) / 8 bytes, msb is the left pixel, 1 = dark
+ * @param width width in pixel
+ * @param height height in pixel
+ * @returns 0 on success, -1 if the file could not be written
+ */
+int host_write_png(const char* file, const unsigned char* image, int width, int height);
+
+#endif
@@ -0,0 +1,655 @@
+/* mbed library for the mbed Lab Board  128*32 pixel LCD
+ * benchmark of the display library on the host
+ * Released under the MIT License: http://mbed.org/license/mit
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Replays the drawing of the pong demo, two text screens and a display
+// list and reports frames per second and SPI bytes per frame. Then the
+// drawing primitives are called one by one and their calls per second
+// reported. Build and run in the project directory with
+//
+//   g++ -O2 -DC12832_HOST -IC12832 -IC12832/host C12832/*.cpp C12832/host/*.cpp -o lcd_bench
+//   ./lcd_bench [frames] [directory]
+//
+// With a directory the first frames of each workload are also written
+// there as png files, as the lcd would show them.
+//
+// Before the benchmark random scenes are drawn once through a display
+// list and once directly, and random calls of the primitives are drawn
+// once by the library and once pixel by pixel with pixel(). A scene or
+// call where the two differ is reported, and written to the directory
+// if there is one, and the exit code is 1.
+
+#ifdef C12832_HOST
+
+#include "C12832.h"
+#include "DisplayList.h"
+#include "Small_7.h"
+#include <stdlib.h>
+#include <time.h>
+
+// frames written as png with a directory
+#define CAPTURE_FRAMES 16
+
+// random scenes compared between display list and direct drawing
+#define CHECK_SCENES 500
+
+// random calls of the primitives compared with the pixel() reference
+#define CHECK_CALLS 20000
+
+// calls of each primitive per frame given on the command line
+#define PRIMITIVE_CALLS 10
+
+// random positions used by the primitives, filled before the clock starts
+#define PRIMITIVE_ARGS 256
+
+C12832 lcd(D11, D13, D12, D7, D10);
+
+// draws the scenes of the display list check directly, and the
+// primitives pixel by pixel
+C12832 reference(D11, D13, D12, D7, D10);
+
+// countdown of main(), one printf per frame with auto update
+
+static int countdown;
+
+static void countdown_start(void)
+{
+    lcd.set_auto_up(1);
+    countdown = 3;
+}
+
+static void countdown_frame(void)
+{
+    lcd.cls();
+    lcd.locate(0,3);
+    lcd.printf("Temp = %.1f C\nPong will begin in: %d...\n", 21.5, countdown);
+    countdown = (countdown == 1) ? 3 : countdown - 1;
+}
+
+// pong() of main.cpp, the paddle follows the ball instead of the accelerometer
+
+static int ball_x, ball_y, y_pos, bottom_y;
+static bool right, ball_down;
+
+static void pong_start(void)
+{
+    lcd.set_auto_up(0);
+    lcd.cls();
+    ball_x = 3;
+    ball_y = 15;
+    y_pos = 0;
+    bottom_y = y_pos + 10;
+    right = true;
+    ball_down = true;
+}
+
+static void pong_move(void)
+{
+    if(ball_x+3 == 120 && ball_y>y_pos && ball_y<bottom_y && right) right = false;
+    if(ball_x >= 124) right = false;
+    if(ball_x <= 3) right = true;
+    if(ball_y <= 3 || ball_y >= 29) ball_down = !ball_down;
+    ball_x += right ? 2 : -2;
+    ball_y += ball_down ? 1 : -1;
+    if(ball_y < y_pos + 5 && y_pos > 0) {
+        y_pos -= 3;
+    } else if(ball_y > y_pos + 5 && y_pos < 21) {
+        y_pos += 3;
+    }
+    bottom_y = y_pos + 10;
+}
+
+static void pong_frame(void)
+{
+    lcd.line(120, y_pos, 120, bottom_y, 1);
+    lcd.fillcircle(ball_x, ball_y, 3, 1);
+    lcd.present();
+    lcd.fillcircle(ball_x, ball_y, 3, 0);
+    lcd.line(120, y_pos, 120, bottom_y, 0);
+    pong_move();
+}
+
+// pong as a display list, recorded and drawn again each frame with a
+// frame, a score box inverted by XOR and a moving ball
+
+static DisplayList list;
+static int score;
+
+static void list_start(void)
+{
+    pong_start();
+    score = 0;
+}
+
+static void list_frame(void)
+{
+    char text[8];
+
+    list.clear();
+    list.fillrect(0, 0, 127, 31, 0);
+    list.rect(0, 0, 127, 31, 1);
+    list.line(120, y_pos, 120, bottom_y, 1);
+    list.fillcircle(ball_x, ball_y, 3, 1);
+    snprintf(text, sizeof(text), "%d", score);
+    list.text(50, 2, text);
+    list.setmode(XOR);
+    list.fillrect(48, 1, 70, 9, 1);
+    list.setmode(NORMAL);
+    list.draw(lcd);
+    lcd.present();
+
+    if(ball_x <= 3) score++;
+    pong_move();
+}
+
+// status screen, four lines of changing numbers redrawn each frame
+
+static unsigned long ticks;
+
+static void status_start(void)
+{
+    lcd.set_auto_up(0);
+    lcd.cls();
+    ticks = 0;
+}
+
+static void status_frame(void)
+{
+    lcd.locate(0,0);
+    lcd.printf("Uptime %8lu ms", ticks * 30);
+    lcd.locate(0,8);
+    lcd.printf("Temp   %5.1f C", 20.0 + (ticks % 50) / 10.0);
+    lcd.locate(0,16);
+    lcd.printf("X %4d Y %4d Z %4d", (int)(ticks % 64) - 32, (int)(ticks % 17), (int)(ticks % 128) - 64);
+    lcd.locate(0,24);
+    lcd.printf("Frame  %8lu", ticks);
+    lcd.present();
+    ticks++;
+}
+
+struct workload {
+    const char* name;
+    void (*start)(void);
+    void (*frame)(void);
+};
+
+static const workload workloads[] = {
+    {"countdown", countdown_start, countdown_frame},
+    {"pong", pong_start, pong_frame},
+    {"status", status_start, status_frame},
+    {"list", list_start, list_frame},
+};
+
+static int random_int(int low, int high)
+{
+    return low + rand() % (high - low + 1);
+}
+
+// drawing primitives, each call draws at the next of the random positions
+// partly off the screen, without an update of the lcd
+
+struct position {
+    int x0, y0, x1, y1, colour;
+};
+
+static position positions[PRIMITIVE_ARGS];
+static int sprite[16*16];
+static char sprite_bits[64*16/8];
+
+static void primitive_start(void)
+{
+    srand(2);
+    for (int i = 0; i < PRIMITIVE_ARGS; i++) {
+        positions[i].x0 = random_int(-20, 147);
+        positions[i].y0 = random_int(-20, 51);
+        positions[i].x1 = random_int(-20, 147);
+        positions[i].y1 = random_int(-20, 51);
+        positions[i].colour = random_int(0, 1);
+    }
+    for (unsigned int i = 0; i < sizeof(sprite) / sizeof(sprite[0]); i++) sprite[i] = random_int(0, 1);
+    for (unsigned int i = 0; i < sizeof(sprite_bits); i++) sprite_bits[i] = random_int(0, 255);
+    lcd.set_auto_up(0);
+    lcd.setmode(NORMAL);
+    lcd.cls();
+}
+
+static void fillrect_call(int i)
+{
+    const position& p = positions[i % PRIMITIVE_ARGS];
+    lcd.fillrect(p.x0 - 32, p.y0 - 8, p.x0 + 31, p.y0 + 7, p.colour);
+}
+
+static void fillrect_full_call(int i)
+{
+    lcd.fillrect(0, 0, 127, 31, i & 1);
+}
+
+static void rect_call(int i)
+{
+    const position& p = positions[i % PRIMITIVE_ARGS];
+    lcd.rect(p.x0, p.y0, p.x1, p.y1, p.colour);
+}
+
+static void line_call(int i)
+{
+    const position& p = positions[i % PRIMITIVE_ARGS];
+    lcd.line(p.x0, p.y0, p.x1, p.y1, p.colour);
+}
+
+// fill, blit and blitbit through the virtual interface of GraphicsDisplay
+
+static void fill_call(int i)
+{
+    GraphicsDisplay& display = lcd;
+    display.fill(0, 0, 128, 32, i & 1);
+}
+
+static void blit_call(int i)
+{
+    const position& p = positions[i % PRIMITIVE_ARGS];
+    GraphicsDisplay& display = lcd;
+    display.blit(p.x0 - 8, p.y0 - 8, 16, 16, sprite);
+}
+
+static void blitbit_call(int i)
+{
+    const position& p = positions[i % PRIMITIVE_ARGS];
+    GraphicsDisplay& display = lcd;
+    display.blitbit(p.x0 - 32, p.y0 - 8, 64, 16, sprite_bits);
+}
+
+static void print_bm_call(int i)
+{
+    const position& p = positions[i % PRIMITIVE_ARGS];
+    Bitmap bm = {16, 16, 2, sprite_bits};
+    lcd.print_bm(bm, p.x0 - 8, p.y0 - 8);
+}
+
+static void print_bm_full_call(int i)
+{
+    static char image[128*32/8];
+    Bitmap bm = {128, 32, 16, image};
+    lcd.print_bm(bm, 0, 0);
+}
+
+static void cls_call(int i)
+{
+    lcd.cls();
+}
+
+struct primitive {
+    const char* name;
+    void (*call)(int i);
+};
+
+static const primitive primitives[] = {
+    {"fillrect64", fillrect_call},
+    {"fillrect128", fillrect_full_call},
+    {"rect", rect_call},
+    {"line", line_call},
+    {"fill128", fill_call},
+    {"blit16", blit_call},
+    {"blitbit64", blitbit_call},
+    {"print_bm16", print_bm_call},
+    {"print_bm128", print_bm_full_call},
+    {"cls", cls_call},
+};
+
+// record a random scene in the list and draw the same commands directly
+// to the reference, commands that do not fit in the list are left out
+
+static void random_scene(DisplayList& dl, C12832& direct)
+{
+    static const char* const strings[] = {"A", "Temp 21.5", "Hello mbed", "0123456789:;<=>?", "x\ny"};
+    int n = random_int(1, 24);
+
+    dl.clear();
+    for (int i = 0; i < n; i++) {
+        int x0 = random_int(-20, 147), y0 = random_int(-20, 51);
+        int x1 = random_int(-20, 147), y1 = random_int(-20, 51);
+        int r = random_int(0, 20), colour = random_int(0, 1);
+        const char* s = strings[random_int(0, 4)];
+        switch (random_int(0, 6)) {
+            case 0:
+                if (dl.setmode(colour ? XOR : NORMAL) == 0) direct.setmode(colour ? XOR : NORMAL);
+                break;
+            case 1:
+                if (dl.line(x0, y0, x1, y1, colour) == 0) direct.line(x0, y0, x1, y1, colour);
+                break;
+            case 2:
+                if (dl.rect(x0, y0, x1, y1, colour) == 0) direct.rect(x0, y0, x1, y1, colour);
+                break;
+            case 3:
+                if (dl.fillrect(x0, y0, x1, y1, colour) == 0) direct.fillrect(x0, y0, x1, y1, colour);
+                break;
+            case 4:
+                if (dl.circle(x0, y0, r, colour) == 0) direct.circle(x0, y0, r, colour);
+                break;
+            case 5:
+                if (dl.fillcircle(x0, y0, r, colour) == 0) direct.fillcircle(x0, y0, r, colour);
+                break;
+            case 6:
+                if (dl.text(x0 & 127, y0 & 31, s) == 0) {
+                    direct.locate(x0 & 127, y0 & 31);
+                    direct.printf("%s", s);
+                }
+                break;
+        }
+    }
+}
+
+// compare the framebuffers after drawing random scenes both ways
+
+static int check_display_list(const char* directory)
+{
+    unsigned char image[512];
+    unsigned char expected[512];
+    char file[256];
+    int failed = 0;
+
+    srand(1);
+    for (int i = 0; i < CHECK_SCENES; i++) {
+        lcd.set_auto_up(0);
+        lcd.setmode(NORMAL);
+        lcd.cls();
+        reference.set_auto_up(0);
+        reference.setmode(NORMAL);
+        reference.cls();
+
+        random_scene(list, reference);
+        list.draw(lcd);
+        lcd.get_frame(image, 0);
+        reference.get_frame(expected, 0);
+        if (memcmp(image, expected, sizeof(image)) == 0) {
+            continue;
+        }
+        fprintf(stderr, "display list scene %d differs from direct drawing\n", i);
+        if (directory) {
+            snprintf(file, sizeof(file), "%s/scene_%03d_list.png", directory, i);
+            host_write_png(file, image, 128, 32);
+            snprintf(file, sizeof(file), "%s/scene_%03d_direct.png", directory, i);
+            host_write_png(file, expected, 128, 32);
+        }
+        failed++;
+    }
+    lcd.setmode(NORMAL);
+    printf("display list: %d of %d scenes match direct drawing\n\n", CHECK_SCENES - failed, CHECK_SCENES);
+    return failed ? -1 : 0;
+}
+
+// the primitives drawn with pixel() only, the way the library drew them
+// before they wrote page bytes
+
+static void pixel_line(int x0, int y0, int x1, int y1, int colour)
+{
+    int dx = x1 - x0, dy = y1 - y0;
+    int dx_sym = (dx > 0) ? 1 : -1;
+    int dy_sym = (dy > 0) ? 1 : -1;
+    int di;
+
+    dx = dx_sym*dx;
+    dy = dy_sym*dy;
+    if (dx >= dy) {
+        di = 2*dy - dx;
+        while (x0 != x1) {
+            reference.pixel(x0, y0, colour);
+            x0 += dx_sym;
+            if (di < 0) {
+                di += 2*dy;
+            } else {
+                di += 2*dy - 2*dx;
+                y0 += dy_sym;
+            }
+        }
+    } else {
+        di = 2*dx - dy;
+        while (y0 != y1) {
+            reference.pixel(x0, y0, colour);
+            y0 += dy_sym;
+            if (di < 0) {
+                di += 2*dx;
+            } else {
+                di += 2*dx - 2*dy;
+                x0 += dx_sym;
+            }
+        }
+    }
+    reference.pixel(x0, y0, colour);
+}
+
+static void pixel_rect(int x0, int y0, int x1, int y1, int colour)
+{
+    if (x1 > x0) pixel_line(x0, y0, x1, y0, colour);
+    else pixel_line(x1, y0, x0, y0, colour);
+    if (y1 > y0) pixel_line(x0, y0, x0, y1, colour);
+    else pixel_line(x0, y1, x0, y0, colour);
+    if (x1 > x0) pixel_line(x0, y1, x1, y1, colour);
+    else pixel_line(x1, y1, x0, y1, colour);
+    if (y1 > y0) pixel_line(x1, y0, x1, y1, colour);
+    else pixel_line(x1, y1, x1, y0, colour);
+}
+
+// a fixed colour, the colours of a blit or the bits of a blitbit, which
+// are the fixed colour where set and the other colour elsewhere
+
+static void pixel_fill(int x, int y, int w, int h, const int* colour, const char* bits, int fixed)
+{
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            int k = j*w + i;
+            int c = fixed;
+            if (colour) c = colour[k];
+            if (bits) c = (bits[k >> 3] & (0x80 >> (k & 7))) ? fixed : !fixed;
+            reference.pixel(x + i, y + j, c);
+        }
+    }
+}
+
+static void pixel_character(int x, int y, int c)
+{
+    const unsigned char* zeichen = &Small_7[(c - 32) * Small_7[0] + 4];
+    for (int j = 0; j < Small_7[2]; j++) {
+        for (int i = 0; i < Small_7[1]; i++) {
+            unsigned char z = zeichen[Small_7[3] * i + (j >> 3) + 1];
+            reference.pixel(x + i, y + j, (z & (1 << (j & 7))) ? 1 : 0);
+        }
+    }
+}
+
+static void pixel_bitmap(const Bitmap& bm, int x, int y)
+{
+    for (int v = 0; v < bm.ySize; v++) {
+        for (int h = 0; h < bm.xSize; h++) {
+            if (h + x > 127 || v + y > 31) break;
+            reference.pixel(x + h, y + v, (bm.data[bm.Byte_in_Line * v + (h >> 3)] & (0x80 >> (h & 7))) ? 1 : 0);
+        }
+    }
+}
+
+// draw random calls of each primitive on a random screen, once by the
+// library and once with pixel(), and compare the framebuffers. The
+// screen is drawn again every 16 calls and after a difference.
+
+static int check_primitives(const char* directory)
+{
+    static const char* const names[] = {"line", "rect", "fillrect", "fill", "blit", "blitbit", "character", "print_bm"};
+    const int kinds = sizeof(names) / sizeof(names[0]);
+    unsigned char image[512];
+    unsigned char expected[512];
+    char file[256];
+    int colours[40*40];
+    char data[(40/8 + 3) * 40];
+    int failed = 0;
+    bool redraw = true;
+
+    srand(3);
+    lcd.set_auto_up(0);
+    reference.set_auto_up(0);
+    for (int i = 0; i < CHECK_CALLS; i++) {
+        int kind = i % kinds;
+        int mode = random_int(0, 1) ? XOR : NORMAL;
+        lcd.setmode(NORMAL);
+        reference.setmode(NORMAL);
+        for (int y = 0; (redraw || i % 16 == 0) && y < 32; y++) {
+            for (int x = 0; x < 128; x += 8) {
+                int bits = rand();
+                for (int b = 0; b < 8; b++) {
+                    lcd.pixel(x + b, y, (bits >> b) & 1);
+                    reference.pixel(x + b, y, (bits >> b) & 1);
+                }
+            }
+        }
+        redraw = false;
+        lcd.setmode(mode);
+        reference.setmode(mode);
+
+        int x0 = random_int(-20, 147), y0 = random_int(-20, 51);
+        int x1 = random_int(-20, 147), y1 = random_int(-20, 51);
+        int w = random_int(0, 40), h = random_int(0, 40);
+        int colour = random_int(0, 1);
+        //horizontal and vertical lines take their own path
+        if (random_int(0, 3) == 0) x1 = x0;
+        else if (random_int(0, 2) == 0) y1 = y0;
+        for (int k = 0; k < w*h; k++) colours[k] = random_int(0, 1);
+        for (unsigned int k = 0; k < sizeof(data); k++) data[k] = random_int(0, 255);
+
+        switch (kind) {
+            case 0:
+                lcd.line(x0, y0, x1, y1, colour);
+                pixel_line(x0, y0, x1, y1, colour);
+                break;
+            case 1:
+                lcd.rect(x0, y0, x1, y1, colour);
+                pixel_rect(x0, y0, x1, y1, colour);
+                break;
+            case 2:
+                lcd.fillrect(x0, y0, x1, y1, colour);
+                pixel_fill(x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, abs(x1 - x0) + 1, abs(y1 - y0) + 1, NULL, NULL, colour);
+                break;
+            case 3:
+                lcd.fill(x0, y0, w, h, colour);
+                pixel_fill(x0, y0, w, h, NULL, NULL, colour);
+                break;
+            case 4:
+                lcd.blit(x0, y0, w, h, colours);
+                pixel_fill(x0, y0, w, h, colours, NULL, 0);
+                break;
+            case 5:
+                lcd.foreground(colour);
+                lcd.background(!colour);
+                lcd.blitbit(x0, y0, w, h, data);
+                pixel_fill(x0, y0, w, h, NULL, data, colour);
+                break;
+            case 6:
+                lcd.character(x0, y0, 32 + (x1 & 0x7F) % 96);
+                pixel_character(x0, y0, 32 + (x1 & 0x7F) % 96);
+                break;
+            case 7: {
+                //rows of the bitmap may be padded
+                Bitmap bm = {w ? w : 1, h ? h : 1, ((w ? w : 1) + 7) / 8 + random_int(0, 2), data};
+                lcd.print_bm(bm, x0, y0);
+                pixel_bitmap(bm, x0, y0);
+                break;
+            }
+        }
+
+        lcd.get_frame(image, 0);
+        reference.get_frame(expected, 0);
+        if (memcmp(image, expected, sizeof(image)) == 0) {
+            continue;
+        }
+        fprintf(stderr, "%s call %d differs from the pixel() reference\n", names[kind], i);
+        redraw = true;
+        if (directory) {
+            snprintf(file, sizeof(file), "%s/%s_%05d_library.png", directory, names[kind], i);
+            host_write_png(file, image, 128, 32);
+            snprintf(file, sizeof(file), "%s/%s_%05d_pixel.png", directory, names[kind], i);
+            host_write_png(file, expected, 128, 32);
+        }
+        failed++;
+    }
+    lcd.setmode(NORMAL);
+    reference.setmode(NORMAL);
+    printf("primitives: %d of %d calls match the pixel() reference\n\n", CHECK_CALLS - failed, CHECK_CALLS);
+    return failed ? -1 : 0;
+}
+
+static int capture(const workload& w, const char* directory)
+{
+    unsigned char image[512];
+    char file[256];
+
+    w.start();
+    for (int i = 0; i < CAPTURE_FRAMES; i++) {
+        w.frame();
+        lcd.get_frame(image, 1);
+        snprintf(file, sizeof(file), "%s/%s_%03d.png", directory, w.name, i);
+        if (host_write_png(file, image, 128, 32) < 0) {
+            fprintf(stderr, "cannot write %s\n", file);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 10000;
+    const char* directory = (argc > 2) ? argv[2] : NULL;
+
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames] [directory]\n", argv[0]);
+        return 1;
+    }
+
+    if (check_display_list(directory) < 0 || check_primitives(directory) < 0) {
+        return 1;
+    }
+
+    printf("%-10s %8s %12s %16s\n", "workload", "frames", "frames/s", "SPI bytes/frame");
+    for (unsigned int n = 0; n < sizeof(workloads) / sizeof(workloads[0]); n++) {
+        const workload& w = workloads[n];
+        if (directory && capture(w, directory) < 0) {
+            return 1;
+        }
+
+        w.start();
+        unsigned long bytes = host_spi_bytes;
+        clock_t begin = clock();
+        for (int i = 0; i < frames; i++) {
+            w.frame();
+        }
+        double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+        bytes = host_spi_bytes - bytes;
+
+        printf("%-10s %8d %12.0f %16.1f\n", w.name, frames,
+               seconds > 0 ? frames / seconds : 0.0, (double)bytes / frames);
+    }
+
+    int calls = frames * PRIMITIVE_CALLS;
+    printf("\n%-11s %7s %12s %16s\n", "primitive", "calls", "calls/s", "us/call");
+    for (unsigned int n = 0; n < sizeof(primitives) / sizeof(primitives[0]); n++) {
+        const primitive& p = primitives[n];
+        primitive_start();
+        clock_t begin = clock();
+        for (int i = 0; i < calls; i++) {
+            p.call(i);
+        }
+        double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+        printf("%-11s %7d %12.0f %16.3f\n", p.name, calls,
+               seconds > 0 ? calls / seconds : 0.0, seconds * 1e6 / calls);
+    }
+    return 0;
+}
+
+#endif
@@ -27,10 +27,13 @@ void pong(int ball_x, int y_pos){
     bool right = true;
     //ball moving down
     bool ball_down = true;
+    //frames are drawn off screen and shown at once with present()
+    lcd.set_auto_up(0);
     while(true) {
         //refresh the position of ball and paddle
         lcd.line(120, y_pos, 120, bottom_y, 1);
         lcd.fillcircle(ball_x, ball_y, 3, 1);
+        lcd.present();
         wait(.03);
         lcd.fillcircle(ball_x, ball_y, 3, 0);
         lcd.line(120, y_pos, 120, bottom_y, 0);
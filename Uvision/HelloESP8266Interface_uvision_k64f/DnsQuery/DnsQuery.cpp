@@ -15,7 +15,16 @@
  * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#ifdef __unix__
+//Also built on the host with PosixNetworkInterface
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#else
 #include "mbed.h"
+#include "us_ticker_api.h"
+#endif
 #include "DnsQuery.h"
 
 //Debug is disabled by default
@@ -37,6 +46,18 @@
 
 
 
+//  Free running microsecond clock, differences stay right across a wrap
+static uint32_t clock_us(void)
+{
+#ifdef __unix__
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_usec);
+#else
+    return us_ticker_read();
+#endif
+}
+
 DnsQuery::DnsQuery(SocketInterface *sock,const char* hostname, char* ipaddress)
 {
     socket = sock;
@@ -45,179 +66,348 @@ DnsQuery::DnsQuery(SocketInterface *sock,const char* hostname, char* ipaddress)
 
 bool DnsQuery::getHostByName(const char* hostname, char* resolvedIp)
 {
-    char * dnsIPs[] = {
+    static const char * dnsIPs[] = {
         "8.8.8.8",
         "209.244.0.3",
         "84.200.69.80",
         "8.26.56.26",
         "208.67.222.222"
     };
-    for(int i = 0; i<5; i++){
+    //  One socket asks every server in turn, without reconnecting
+    bool found = false;
+    for(int i = 0; i<5 && !found; i++){
         _dnsip = dnsIPs[i];
-        if(this->getIP(hostname, resolvedIp)){
-            return true;   
-        }
-           
+        found = this->getIP(hostname, resolvedIp);
     }
-    return false;
+    socket->close();
+    return found;
     
 }
 
 bool DnsQuery::getIP(const char* hostname, char* ipaddress)
 {
     INFO("%s", hostname);
-    int len = 0;
     if (hostname == NULL)
         return false;
-    len = strlen(hostname);
-    if ((len >128) || (len == 0))
+
+    //  The query and then the answer share one buffer on the stack
+    uint8_t packet[DNS_MAX_PACKET];
+    uint16_t id = randomID();
+    int packetlen = buildQuery(packet, sizeof(packet), id, hostname);
+    if (packetlen < 0)
         return false;
     
-    int packetlen = /* size of HEADER structure */ 12 + /* size of QUESTION Structure */5 + len + 1;
-    char *packet = new char[packetlen]; /* this is the UDP packet to send to the DNS */
-    if (packet == NULL)
+    //  Ready to send to DNS
+    INFO("Sending packet of length %d",packetlen);
+    if (socket->sendTo(_dnsip, 53, packet, packetlen) < 0) {
         return false;
+    }
+    
+    //  Receive the answer from DNS, a late answer from a server asked before fails the ID check
+    INFO("Recieving");
+    char from[16];
+    uint16_t port;
+    int response_length = socket->recvFrom(from, &port, packet, sizeof(packet));
+    if (response_length > 0) {
+        if (parseResponse(packet, response_length, id, ipaddress)) {
+            return true;
+        }
+    } else {
+        ERR("SocketRecvFrom returned %d !", response_length);
+    }
+    ERR("NO IP FOUND\n");
+    return false;
+}
+
+int DnsQuery::lookup(SocketInterface *sock, dns_lookup_t *lookups, int count, uint32_t timeout_ms)
+{
+    struct {
+        uint16_t id;
+        int index;
+    } pending[DNS_MAX_OUTSTANDING];
+    int outstanding = 0;
+
+    //  Answers may arrive back to back in one read, a whole one plus the start of the next
+    uint8_t query[DNS_MAX_PACKET];
+    uint8_t buffer[2*DNS_MAX_PACKET];
+    int have = 0;
+
+    for (int i = 0; i < count; i++)
+        lookups[i].found = 0;
+
+    //  Every name takes an A query and, when asked for, an AAAA query
+    int next = 0;
+    uint32_t start = clock_us();
+    while ((next < 2*count) || (outstanding > 0)) {
+        while ((next < 2*count) && (outstanding < DNS_MAX_OUTSTANDING)) {
+            dns_lookup_t &l = lookups[next/2];
+            uint16_t qtype = (next % 2) ? DNS_TYPE_AAAA : DNS_TYPE_A;
+            next++;
+            if ((qtype == DNS_TYPE_AAAA) && !l.ipv6)
+                continue;
+            //  IDs have to tell the outstanding queries apart
+            uint16_t id;
+            bool used;
+            do {
+                id = randomID();
+                used = false;
+                for (int p = 0; p < outstanding; p++)
+                    used = used || (pending[p].id == id);
+            } while (used);
+            int len = buildQuery(query, sizeof(query), id, l.hostname, qtype);
+            if ((len < 0) || (sock->send(query, len) < 0))
+                continue;
+            pending[outstanding].id = id;
+            pending[outstanding].index = &l - lookups;
+            outstanding++;
+        }
+        if (outstanding == 0)
+            break;
+
+        int left = (int)timeout_ms - (int)((clock_us() - start) / 1000);
+        if (left <= 0)
+            break;
+        int n = sock->recv(buffer + have, sizeof(buffer) - have, left);
+        if (n <= 0)
+            break;
+        have += n;
+
+        while (have > 0) {
+            int m = messageLength(buffer, have);
+            if (m == 0) {
+                //  Wait for the rest, unless it can never fit
+                if (have == (int)sizeof(buffer))
+                    have = 0;
+                break;
+            }
+            if (m < 0) {
+                have = 0;
+                break;
+            }
+            uint16_t id = (buffer[0] << 8) | buffer[1];
+            for (int p = 0; p < outstanding; p++) {
+                if (pending[p].id != id)
+                    continue;
+                dns_lookup_t &l = lookups[pending[p].index];
+                int found = parseAnswers(buffer, m, id, l.addrs + l.found, l.count - l.found);
+                if (found > 0)
+                    l.found += found;
+                pending[p] = pending[--outstanding];
+                break;
+            }
+            memmove(buffer, buffer + m, have - m);
+            have -= m;
+        }
+    }
+
+    int resolved = 0;
+    for (int i = 0; i < count; i++) {
+        if (lookups[i].found > 0)
+            resolved++;
+    }
+    return resolved;
+}
+
+int DnsQuery::buildQuery(uint8_t *packet, int size, uint16_t id, const char *hostname, uint16_t qtype)
+{
+    int len = strlen(hostname);
+    //  Header, the name as labels plus its terminating zero, QTYPE and QCLASS
+    int packetlen = 12 + 1 + len + 1 + 4;
+    if ((len == 0) || (len > 253) || (packetlen > size))
+        return -1;
     
     //  Fill the header
-    memset(packet, 0, packetlen);
-    packet[1] = 1;      //  ID = 1
-    packet[5] = 1;      // QDCOUNT = 1 (contains one question)
+    memset(packet, 0, 12);
+    packet[0] = id >> 8;
+    packet[1] = id & 0xFF;
     packet[2] = 1;      // recursion requested
+    packet[5] = 1;      // QDCOUNT = 1 (contains one question)
 
     int c = 13;         //  point to NAME element in question section or request
-    int cnt = 12;       //  points to the counter of
+    int cnt = 12;       //  points to the counter of the current label
     packet[cnt] = 0;
     for (int i = 0 ; i < len ; i++) {
         if (hostname[i] != '.') {
             //  Copy the character and increment the character counter
-            packet[cnt]++;
+            if (++packet[cnt] > 63)
+                return -1;
             packet[c++] = hostname[i];
         } else {
-            //  Finished with this part, so go to the next
+            //  Finished with this part, so go to the next, empty labels are not allowed
+            if (packet[cnt] == 0)
+                return -1;
             cnt = c++;
             packet[cnt] = 0;
         }
     }
     
-    //  Terminate this domain name with a zero entry
-    packet[c++] = 0;
+    //  Terminate this domain name with a zero entry, a trailing dot already did
+    if (packet[cnt] != 0)
+        packet[c++] = 0;
     
     //  Set QTYPE
-    packet[c++] = 0;
-    packet[c++] = 1;
+    packet[c++] = qtype >> 8;
+    packet[c++] = qtype & 0xFF;
     //  Set QCLASS
     packet[c++] = 0;
     packet[c++] = 1;
-    
-    
-    //  Ready to send to DNS
-    socket->setAddressPort(_dnsip, 53);
-    socket->open();
-   
-    INFO("Sending packet of length %d",packetlen);
-    /*
-    for( int i = 0 ; i < c ; i++) {
-        printf("%02x ", packet[i]);
-    }
-    */
-    if (socket->send(packet, packetlen) < 0) {
-        delete packet;
-        return false;
-    }
-    delete packet;
-    
-    packet = new char [1024];
-    
-    //  Receive the answer from DNS
-    int response_length = 0;
-    INFO("Recieving");
-    response_length = socket->recv(packet, 1024);
-        /*
-        for( int i = 0 ; i < 1024; i++) {
-            printf("%02x ", packet[i]);
-        }
-        */
-    if (response_length > 0 ) {
-        if (!resolve(packet, ipaddress)) {
-            socket->close();
-            delete packet;
-            ERR("NO IP FOUND\n");
-            return false;
+    return c;
+}
+
+int DnsQuery::skipName(const uint8_t *resp, int len, int c)
+{
+    while (c < len) {
+        int n = resp[c];
+        if (n == 0)
+            return c + 1;
+        if ((n & 0xC0) == 0xC0) {
+            //  A pointer ends the name
+            return (c + 2 <= len) ? c + 2 : -1;
         }
-                        
-        //  cleanup and return
-        delete packet;
-        socket->close();
-        return true;
-    } else {
-        ERR("SocketRecvFrom returned %d !", response_length);
+        if ((n & 0xC0) != 0)
+            return -1;  //  reserved label types
+        c += n + 1;
     }
-    socket->close();
-    delete packet;
-    ERR("NO IP FOUND\n");
-    return false;
+    return -1;
 }
 
-
-bool DnsQuery::resolve(char* resp, char* ipaddress)
+int DnsQuery::parseAnswers(const uint8_t *resp, int len, uint16_t id, dns_addr_t *addrs, int count)
 {
-    
-    int ID = (((int)resp[0]) <<8) + resp[1];
-    int QR = resp[2] >>7;
-    int Opcode = (resp[2]>>3) & 0x0F;
-    int RCODE = (resp[3] & 0x0F);
-    int ANCOUNT = (((int)resp[6])<<8)+ resp[7];
+    if (len < 12)
+        return -1;
+
+    int ID = (resp[0] << 8) | resp[1];
+    int QR = resp[2] >> 7;
+    int Opcode = (resp[2] >> 3) & 0x0F;
+    int RCODE = resp[3] & 0x0F;
+    int QDCOUNT = (resp[4] << 8) | resp[5];
+    int ANCOUNT = (resp[6] << 8) | resp[7];
     
     INFO("Resolving response : ID = %d, QR = %d, Opcode = %d, RCODE = %d", ID, QR, Opcode, RCODE);
-    if ((ID != 1) || (QR != 1) || (Opcode != 0) || (RCODE != 0)) {
+    if ((ID != id) || (QR != 1) || (Opcode != 0) || (RCODE != 0)) {
         ERR("Received non matching response from DNS !");
-        return false;
+        return -1;
     }
     
+    //  Skip the questions, QTYPE and QCLASS follow each name
     int c = 12;
-    int d;
-    //  Skip domain question
-    while(  (d=resp[c++]) != 0) {
-        c+=d;
+    for (int q = 0; q < QDCOUNT; q++) {
+        c = skipName(resp, len, c);
+        if ((c < 0) || (c + 4 > len))
+            return -1;
+        c += 4;
     }
-    c+= 4; //   skip QTYPE and QCLASS
     
-    //  Here comes the resource record
-    for (int ans = 0 ; ans < ANCOUNT; ans++) {
-        if (parseRR(resp, c, ipaddress)) {
-            return true;
+    //  Here come the resource records, CNAMEs and the like are skipped
+    int found = 0;
+    for (int ans = 0; ans < ANCOUNT; ans++) {
+        c = skipName(resp, len, c);
+        if ((c < 0) || (c + 10 > len))
+            return -1;
+        int TYPE = (resp[c] << 8) | resp[c+1];
+        int CLASS = (resp[c+2] << 8) | resp[c+3];
+        uint32_t TTL = ((uint32_t)resp[c+4] << 24) | ((uint32_t)resp[c+5] << 16) | ((uint32_t)resp[c+6] << 8) | resp[c+7];
+        int RDLENGTH = (resp[c+8] << 8) | resp[c+9];
+        c += 10;
+        if (c + RDLENGTH > len)
+            return -1;
+
+        INFO("Record of TYPE=%d and CLASS=%d detected !", TYPE, CLASS);
+        bool v4 = (TYPE == DNS_TYPE_A) && (RDLENGTH == 4);
+        bool v6 = (TYPE == DNS_TYPE_AAAA) && (RDLENGTH == 16);
+        if ((CLASS == 1) && (v4 || v6) && (found < count)) {
+            addrs[found].version = v4 ? 4 : 6;
+            memcpy(addrs[found].addr, &resp[c], RDLENGTH);
+            //  TTLs with the top bit set are treated as zero
+            addrs[found].ttl = (TTL & 0x80000000) ? 0 : TTL;
+            found++;
         }
+        c += RDLENGTH;
     }
     
+    return found;
+}
+
+bool DnsQuery::parseResponse(const uint8_t *resp, int len, uint16_t id, char *ipaddress, uint32_t *ttl)
+{
+    dns_addr_t addrs[4];
+    int found = parseAnswers(resp, len, id, addrs, 4);
+    for (int i = 0; i < found; i++) {
+        if (addrs[i].version == 4) {
+            addressToString(&addrs[i], ipaddress);
+            if (ttl)
+                *ttl = addrs[i].ttl;
+            return true;
+        }
+    }
     return false;
 }
 
-bool DnsQuery::parseRR(char *resp, int& c, char* adr )
+int DnsQuery::messageLength(const uint8_t *resp, int len)
 {
-    int n = 0;
-    while( (n=resp[c++]) != 0) {
-        if ((n & 0xc0) != 0) {
-            //  This is a link
-            c++;
-            break;
-        } else {
-            c+= n;  //  skip this segment, not interested in string domain names
+    if (len < 12)
+        return 0;
+    //  Questions, then answer, authority and additional records
+    int c = 12;
+    int sections[4];
+    for (int s = 0; s < 4; s++)
+        sections[s] = (resp[4 + 2*s] << 8) | resp[5 + 2*s];
+    for (int s = 0; s < 4; s++) {
+        for (int r = 0; r < sections[s]; r++) {
+            //  Names are only checked as far as data has arrived
+            while (true) {
+                if (c >= len)
+                    return 0;
+                int n = resp[c];
+                if (n == 0) {
+                    c += 1;
+                    break;
+                }
+                if ((n & 0xC0) == 0xC0) {
+                    c += 2;
+                    break;
+                }
+                if ((n & 0xC0) != 0)
+                    return -1;
+                c += n + 1;
+            }
+            if (s == 0) {
+                c += 4;
+            } else {
+                if (c + 10 > len)
+                    return 0;
+                c += 10 + ((resp[c+8] << 8) | resp[c+9]);
+            }
+            if (c > DNS_MAX_PACKET)
+                return -1;
         }
     }
-    
-    int TYPE = (((int)resp[c])<<8) + resp[c+1];
-    int CLASS = (((int)resp[c+2])<<8) + resp[c+3];
-    int RDLENGTH = (((int)resp[c+8])<<8) + resp[c+9];
-
-    INFO("Record of TYPE=%d and CLASS=%d detected !", TYPE, CLASS);
-    c+= 10;
-    if ((CLASS == 1) && (TYPE == 1)) {
-        sprintf(adr,"%d.%d.%d.%d", resp[c], resp[c+1], resp[c+2], resp[c+3]);
-        c+= RDLENGTH;
-        return true;
-    } else {
+    return (c <= len) ? c : 0;
+}
+
+void DnsQuery::addressToString(const dns_addr_t *addr, char *str)
+{
+    const uint8_t *a = addr->addr;
+    if (addr->version == 4) {
+        sprintf(str, "%d.%d.%d.%d", a[0], a[1], a[2], a[3]);
+        return;
     }
-    c+= RDLENGTH;
-    
-    return false;
-}
\ No newline at end of file
+    sprintf(str, "%x:%x:%x:%x:%x:%x:%x:%x",
+        (a[0] << 8) | a[1], (a[2] << 8) | a[3], (a[4] << 8) | a[5], (a[6] << 8) | a[7],
+        (a[8] << 8) | a[9], (a[10] << 8) | a[11], (a[12] << 8) | a[13], (a[14] << 8) | a[15]);
+}
+
+uint16_t DnsQuery::randomID(void)
+{
+    static bool seeded = false;
+    if (!seeded) {
+        srand(clock_us());
+        seeded = true;
+    }
+    uint16_t id;
+    do {
+        //  rand() may only give 15 bits
+        id = ((rand() & 0xFF) << 8) | (rand() & 0xFF);
+    } while (id == 0);
+    return id;
+}
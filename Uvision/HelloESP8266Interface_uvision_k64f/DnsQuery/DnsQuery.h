@@ -18,7 +18,39 @@
 #ifndef __DNSQUERY_H__
 #define __DNSQUERY_H__
 
+#include <stddef.h>
 #include "SocketInterface.h"
+
+/* Largest DNS message over UDP */
+#define DNS_MAX_PACKET 512
+
+/* Record types */
+#define DNS_TYPE_A      1
+#define DNS_TYPE_AAAA   28
+
+/* Queries lookup() keeps in flight on its socket */
+#ifndef DNS_MAX_OUTSTANDING
+#define DNS_MAX_OUTSTANDING 8
+#endif
+
+/** Address from an A or AAAA record
+ */
+typedef struct dns_addr_t {
+    uint8_t version;        /*!< 4 for an A record, 6 for an AAAA record */
+    uint8_t addr[16];       /*!< Address in network order, 4 bytes used for IPv4 */
+    uint32_t ttl;           /*!< Time to live in seconds */
+} dns_addr_t;
+
+/** One name resolved by DnsQuery::lookup
+ */
+typedef struct dns_lookup_t {
+    const char *hostname;   /*!< Name to resolve */
+    bool ipv6;              /*!< Also ask for AAAA records */
+    dns_addr_t *addrs;      /*!< Receives the addresses found */
+    int count;              /*!< Number of entries in addrs */
+    int found;              /*!< Set to the number of addresses found */
+} dns_lookup_t;
+
 class DnsQuery
 {
 public:
@@ -27,6 +59,56 @@ public:
       */
     DnsQuery(SocketInterface* sock,const char* hostname, char* ipaddress);
  
+    /** Function lookup resolves several names over one socket, with their queries in flight together.
+      * Up to DNS_MAX_OUTSTANDING queries are outstanding at a time, answers are matched to them by ID.
+      * @param sock : a UDP socket opened to the DNS server
+      * @param lookups : the names to resolve, found is set in each
+      * @param count : the number of entries in lookups
+      * @param timeout_ms : the longest time to wait for all answers
+      * @returns the number of names with at least one address.
+      */
+    static int lookup(SocketInterface *sock, dns_lookup_t *lookups, int count, uint32_t timeout_ms = 15000);
+
+    /** Function buildQuery encodes the question for a record of a hostname.
+      * @param packet : the buffer receiving the query, nothing is written past size
+      * @param size : the size of packet in bytes
+      * @param id : the ID of the query, the answer carries the same ID
+      * @param hostname : the hostname of interest as a string.
+      * @param qtype : the record type asked for, DNS_TYPE_A or DNS_TYPE_AAAA
+      * @returns the length of the query, or -1 if the hostname is invalid or does not fit.
+      */
+    static int buildQuery(uint8_t *packet, int size, uint16_t id, const char *hostname, uint16_t qtype = DNS_TYPE_A);
+    /** Function parseAnswers decodes every A and AAAA record of an answer, nothing is read past len.
+      * @param resp : the answer as received
+      * @param len : the length of the answer in bytes
+      * @param id : the ID of the query
+      * @param addrs : receives the addresses in the order of the records
+      * @param count : the number of entries in addrs, further records are skipped
+      * @returns the number of addresses stored, or -1 if the answer is invalid.
+      */
+    static int parseAnswers(const uint8_t *resp, int len, uint16_t id, dns_addr_t *addrs, int count);
+    /** Function parseResponse decodes the answer to a query from buildQuery, nothing is read past len.
+      * @param resp : the answer as received
+      * @param len : the length of the answer in bytes
+      * @param id : the ID of the query
+      * @param ipaddress : receives the address of the first A record as a string, 16 bytes
+      * @param ttl : receives the time to live of the record in seconds, may be NULL
+      * @returns true if an A record was found, or false otherwise.
+      */
+    static bool parseResponse(const uint8_t *resp, int len, uint16_t id, char *ipaddress, uint32_t *ttl = NULL);
+    /** Function messageLength finds where the first of several messages received back to back ends.
+      * @returns the length of the first message, 0 if it is not complete yet, or -1 if it is invalid.
+      */
+    static int messageLength(const uint8_t *resp, int len);
+    /** Function addressToString formats an address as dotted decimal or as eight hex groups.
+      * @param addr : the address
+      * @param str : receives the string, 40 bytes
+      */
+    static void addressToString(const dns_addr_t *addr, char *str);
+    /** Function randomID picks a query ID, so answers to earlier queries are not mistaken for the current one.
+      * @returns a nonzero ID.
+      */
+    static uint16_t randomID(void);
    
 private:   
     /** Function gethostbyname implements the functionality to query a domain name server for an IP-Address of a given hostname.
@@ -41,11 +123,13 @@ private:
       * @returns true if successful, or false otherwise.
       */
     bool getIP(const char* hostname, char* ipaddress);
-    bool resolve(char* resp, char* ipaddress);
-    bool parseRR(char *resp, int& c, char* adr );
+    /** Function skipName steps over a possibly compressed domain name.
+      * @returns the offset following the name, or -1 if the name runs past len.
+      */
+    static int skipName(const uint8_t *resp, int len, int c);
 
 protected:
-    char* _dnsip;
+    const char* _dnsip;
     char* _string_ip;
     SocketInterface* socket;
     
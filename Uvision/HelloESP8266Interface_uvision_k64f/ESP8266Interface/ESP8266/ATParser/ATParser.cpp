@@ -190,6 +190,8 @@ bool ATParser::vsend(const char *command, va_list args)
 
 bool ATParser::vrecv(const char *response, va_list args)
 {
+    _aborted = false;
+restart:
     // Iterate through each line in the expected response
     while (response[0]) {
         // Since response is const, we need to copy it into our buffer to
@@ -212,6 +214,11 @@ bool ATParser::vrecv(const char *response, va_list args)
             }
         }
 
+        // A line ending in the delimiter has to be matched up to the
+        // delimiter, otherwise a trailing value such as %d would match
+        // as soon as its first digit arrives
+        bool whole_line = (i >= _delim_size && memcmp(&response[i-_delim_size], _delimiter, _delim_size) == 0);
+
         // Scanf has very poor support for catching errors
         // fortunately, we can abuse the %n specifier to determine
         // if the entire string was matched.
@@ -241,12 +248,24 @@ bool ATParser::vrecv(const char *response, va_list args)
             _buffer[offset + j++] = c;
             _buffer[offset + j] = 0;
 
+            // Out-of-band data may arrive while waiting for a response,
+            // its callback can reuse our buffer so the current line
+            // has to be set up again afterwards
+            if (dispatch_oob(_buffer+offset, j)) {
+                if (_aborted) {
+                    debug_if(at_echo, "AT(Aborted)\r\n");
+                    return false;
+                }
+                goto restart;
+            }
+
             // Check for match
             int count = -1;
             sscanf(_buffer+offset, _buffer, &count);
 
             // We only succeed if all characters in the response are matched
-            if (count == j) {
+            if (count == j && (!whole_line ||
+                    (j >= _delim_size && memcmp(&_buffer[offset + j-_delim_size], _delimiter, _delim_size) == 0))) {
                 debug_if(at_echo, "AT= %s\r\n", _buffer+offset);
                 // Reuse the front end of the buffer
                 memcpy(_buffer, response, i);
@@ -272,6 +291,74 @@ bool ATParser::vrecv(const char *response, va_list args)
 }
 
 
+// Out-of-band data handling
+bool ATParser::oob(const char *prefix, FunctionPointerArg1<void, const char*> func)
+{
+    if (_oob_count >= ATPARSER_MAX_OOBS) {
+        return false;
+    }
+    _oobs[_oob_count].prefix = prefix;
+    _oobs[_oob_count].len = strlen(prefix);
+    _oobs[_oob_count].cb = func;
+    _oob_count++;
+    return true;
+}
+
+bool ATParser::dispatch_oob(const char *line, int size)
+{
+    for (int i = 0; i < _oob_count; i++) {
+        if (size == _oobs[i].len && memcmp(_oobs[i].prefix, line, size) == 0) {
+            debug_if(at_echo, "AT! %s\r\n", _oobs[i].prefix);
+            _oobs[i].cb.call(_oobs[i].prefix);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ATParser::abort()
+{
+    _aborted = true;
+}
+
+bool ATParser::process()
+{
+    bool found = false;
+
+    while (_serial->readable()) {
+        // Once a line has started the rest of it is waited for,
+        // dropping a partial line could lose out-of-band data
+        int j = 0;
+
+        while (true) {
+            // Ran out of space, usually means binary data
+            if (j+1 >= _buffer_size) {
+                break;
+            }
+            int c = getc();
+            if (c < 0) {
+                return found;
+            }
+            _buffer[j++] = c;
+            _buffer[j] = 0;
+
+            if (dispatch_oob(_buffer, j)) {
+                found = true;
+                break;
+            }
+
+            // Discard lines nobody is waiting for
+            if (j >= _delim_size && strcmp(&_buffer[j-_delim_size], _delimiter) == 0) {
+                debug_if(at_echo, "AT< %s", _buffer);
+                break;
+            }
+        }
+    }
+
+    return found;
+}
+
+
 // Mapping to vararg functions
 int ATParser::printf(const char *format, ...)
 {
@@ -19,7 +19,9 @@
 
 #include "WiFiInterface.h"
 #include "ESP8266.h"
-#include "DnsQuery.h"
+#include "DnsResolver.h"
+
+class ESP8266Interface;
 
 /** ESP8266Socket class.
     This is a ESP8266 implementation of a socket that implements the SocketInterface class.
@@ -30,28 +32,40 @@
 class ESP8266Socket : public SocketInterface
 {
 public:
-    ESP8266Socket(uint32_t handle, ESP8266 &driver, socket_protocol_t type, uint8_t id);
+    ESP8266Socket();
+    ESP8266Socket(uint32_t handle, ESP8266Interface &interface, ESP8266 &driver, socket_protocol_t type, uint8_t id);
     virtual const char *getHostByName(const char *name) const;
     virtual void setAddress(const char* addr) ;
     virtual void setPort(uint16_t port) ;
     virtual void setAddressPort(const char* addr, uint16_t port);
     virtual const char *getAddress(void) const;
     virtual uint16_t getPort(void) const;
-    virtual int32_t bind(uint16_t port) const;
-    virtual int32_t listen(void) const;
-    virtual int32_t accept() const;
+    virtual int32_t bind(uint16_t port);
+    virtual int32_t listen(uint32_t backlog = 1);
+    virtual SocketInterface *accept(uint32_t timeout_ms = 15000);
     virtual int32_t open() ;
     virtual int32_t send(const void *data, uint32_t amount, uint32_t timeout_ms = 15000) ;
     virtual uint32_t recv(void *data, uint32_t amount, uint32_t timeout_ms = 15000) ;
+    virtual int32_t sendv(const socket_buffer_t *buffers, uint32_t count, uint32_t timeout_ms = 15000);
+    virtual int32_t recvLend(const void **data, uint32_t timeout_ms = 15000);
+    virtual void recvRelease(uint32_t amount);
+    virtual int32_t sendTo(const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms = 15000);
+    virtual uint32_t recvFrom(char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms = 15000);
     virtual int32_t close() const;
     virtual uint32_t getHandle() const;
     
-    uint8_t getID();
+    uint8_t getID() const;
+    void setID(uint8_t id);
+    socket_protocol_t getType() const;
+    uint16_t getLocalPort() const;
     void handleRecieve();
     
 protected:
     uint8_t _id;    
+    /** Port given to bind, UDP links receive on it */
+    uint16_t _localPort;
     ESP8266* _driver;
+    ESP8266Interface* _interface;
 };
 
 /** ESP8266Interface class.
@@ -73,13 +87,192 @@ public:
     virtual int32_t isConnected(void) ;
     virtual SocketInterface *allocateSocket(socket_protocol_t socketProtocol) ;
     virtual int deallocateSocket(SocketInterface *socket) ;
+    virtual int32_t poll(socket_poll_t *fds, uint32_t count, uint32_t timeout_ms = 15000);
     void getHostByName(const char *name, char* hostIP);
     
+    /** Get the resolver used by getHostByName, to set its servers or flush its cache */
+    DnsResolver &getResolver(void);
+    
+    /** Get the signal strength of the AP
+        @returns RSSI in dBm when last connected or refreshed, 0 if not connected
+     */
+    int32_t getRSSI(void) const;
+    
+    /** Scan for APs, strongest first, see ESP8266::scan
+        @param res array the found APs are copied into
+        @param count number of entries in res
+        @param ssid only scan for APs with this name, NULL for all APs
+        @param minRSSI leave out APs weaker than this, in dBm
+        @returns number of APs copied into res, a negative number on failure
+     */
+    int32_t scan(esp8266_ap_t *res, int count, const char *ssid = NULL, int minRSSI = -128);
+    
+    /** Step the link supervisor, call it regularly from the main loop.
+        Once connected, a lost AP is noticed from the WIFI DISCONNECT message or
+        from the periodic probe, and is rejoined with exponential backoff. Idle
+        pooled links are re-opened to the same endpoints once rejoined, links
+        owned by a socket stay closed so that the socket sees the hangup.
+        The join runs in the background, a call does not wait for it.
+        poll() also steps the supervisor.
+     */
+    void supervise(void);
+    
+    /** Set how often the supervisor asks the ESP8266 whether it is still connected.
+        @param interval_ms probe interval in milliseconds, 0 to rely on WIFI DISCONNECT only
+     */
+    void setProbeInterval(uint32_t interval_ms);
+    
+    /** Get the time spent disconnected from the AP
+        @returns milliseconds without the AP since the first connect, including the current outage
+     */
+    uint32_t getDisconnectedTime(void);
+    
+    /** Set the keepalive used for pooled TCP links.
+        Closed TCP sockets leave their link open so that a later socket to the
+        same address and port can reuse it without a new handshake.
+        @param keepalive_s TCP keepalive interval in seconds, 1-7200, larger
+                           values are limited to 7200, 0 disables pooling
+     */
+    void setKeepAlive(uint16_t keepalive_s);
+    
 private:
+    friend class ESP8266Socket;
+    
+    /** Open the link of a socket, reusing an idle pooled link when possible */
+    int32_t openLink(ESP8266Socket *socket);
+    
+    /** Open the link of a UDP socket with a changing remote, unless it is open already
+        @param addr first destination, NULL when the socket only receives
+        @param port port of the first destination
+     */
+    int32_t openDatagramLink(ESP8266Socket *socket, const char *addr, uint16_t port);
+    
+    /** Close the link of a socket, or keep it idle in the pool */
+    int32_t closeLink(const ESP8266Socket *socket);
+    
+    /** Start the ESP8266 server on the port of a socket */
+    int32_t listenLink(ESP8266Socket *socket, uint32_t backlog);
+    
+    /** Allocate a socket for the next incoming connection of a listening socket */
+    SocketInterface *acceptLink(ESP8266Socket *socket, uint32_t timeout_ms);
+    
+    /** Take a free slot for a socket on a link id, NULL if all slots are used */
+    ESP8266Socket *allocateSlot(socket_protocol_t socketProtocol, uint8_t id);
+    
+    /** Reserve an unused link id, evicting the oldest idle link if needed
+        @param exclude id that must not be taken, -1 for none
+        @returns the id, -1 if all links are in use
+     */
+    int takeFreeLink(int exclude);
+    
+    /** Find an idle link connected to the given endpoint, -1 if none */
+    int findIdleLink(socket_protocol_t type, const char *addr, uint16_t port);
+    
+    /** Look up an allocated socket by handle, NULL if the handle is stale */
+    ESP8266Socket *findSocket(uint32_t handle);
+    
+    /** Forget pooled links that the remote host has closed */
+    void reapClosedLinks(void);
+    
+    /** Remember the AP joined last so that connect(timeout_ms) can rejoin it directly */
+    void rememberAP(const char *ap, const char *pass_phrase);
+    
+    /** Query the link state from the ESP8266 into the cached status */
+    void refreshStatus(void);
+    
+    /** Refresh the cached status if the ESP8266 reported a connection change */
+    void updateStatus(void);
+    
+    /** Start supervising the link after a successful connect */
+    void startSupervision(void);
+    
+    /** Close the books on an outage and re-open the idle links it dropped */
+    void restoreLinks(void);
+    
+    /** Ticker callback, the probe itself needs the serial port and runs from supervise() */
+    void probeTick(void);
+    
+    /** State of a link id, kept after its socket is closed while the link is pooled */
+    struct PooledLink {
+        bool open;
+        bool idle;
+        socket_protocol_t type;
+        char addr[64];
+        uint16_t port;
+        /** Local port of a UDP link opened by openDatagramLink, 0 otherwise */
+        uint16_t localPort;
+        uint32_t lastUsed;
+    };
+    
     ESP8266 esp8266;
+    DnsResolver resolver;
+    /** Whether the firmware resolves names with AT+CIPDOMAIN, -1 until known */
+    int8_t moduleDNS;
+    /** AT+CIPDOMAIN reports no TTL, its answers are cached this many seconds */
+    static const uint32_t moduleDNSTTL = 60;
     static const int numSockets = 5;
-    int availableID[numSockets];
-    char ip[100];
+    static const uint16_t defaultKeepAlive = 60;
+    
+    /** One slot per link plus one for a listening socket, which owns no link */
+    static const int numSlots = numSockets + 1;
+    
+    /** Socket slots, handles are allocated so that handle % numSlots is the slot */
+    ESP8266Socket socketSlots[numSlots];
+    /** Handle of the socket in each slot, freeSlot if unused */
+    static const uint32_t freeSlot = 0xFFFFFFFF;
+    uint32_t slotHandle[numSlots];
+    /** Slot of the socket owning each link id, -1 for unowned links */
+    int8_t linkSlot[numSockets];
+    /** Slot of the listening socket, -1 when the server is not running */
+    int listenSlot;
+    /** Link id of a socket that gave its link back to the server */
+    static const uint8_t noLink = 0xFF;
+    PooledLink pool[numSockets];
+    uint32_t useCounter;
+    uint16_t keepAlive;
+    /** Next local port for UDP sockets that were not bound */
+    uint16_t nextLocalPort;
+    static const uint16_t firstLocalPort = 49152;
+    
+    /** Link state cached by refreshStatus(), the getters return these without serial traffic */
+    bool connected;
+    char ip[16];
+    char gateway[16];
+    char netmask[16];
+    char mac[18];
+    int32_t rssi;
+    
+    static const uint32_t defaultProbeInterval = 5000;
+    static const uint32_t minBackoff = 1000;
+    static const uint32_t maxBackoff = 60000;
+    /** Longest wait for a rejoin, the ESP8266 normally ends it with FAIL sooner */
+    static const uint32_t joinTimeout = 20000;
+    
+    /** Supervisor state, supervising is set from the first connect until disconnect */
+    Ticker probeTicker;
+    volatile bool probeDue;
+    uint32_t probeInterval;
+    bool supervising;
+    bool linkDown;
+    /** Set while a join sent by the supervisor runs, started joinStart ms into the outage */
+    bool rejoining;
+    uint32_t joinStart;
+    /** Time into the current outage, and total of the outages before it */
+    Timer downTimer;
+    uint32_t downTotal;
+    /** Next reconnect attempt, in milliseconds into the outage */
+    uint32_t nextAttempt;
+    uint32_t backoff;
+    /** Links with an endpoint that were open when the AP was lost */
+    uint8_t lostLinks;
+    /** Set by init(ip, mask, gateway), DHCP is left off while set */
+    bool staticIP;
+    /** Last AP joined, haveAP is false until a connect succeeds */
+    bool haveAP;
+    char lastAP[33];
+    char lastPassPhrase[65];
+    char lastBSSID[18];
+    int lastChannel;
 };
 
 #endif
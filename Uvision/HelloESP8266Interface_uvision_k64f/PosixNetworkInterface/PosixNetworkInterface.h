@@ -0,0 +1,122 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POSIXNETWORKINTERFACE_H
+#define POSIXNETWORKINTERFACE_H
+
+#ifdef __unix__
+
+#include "WiFiInterface.h"
+
+#ifndef POSIX_MAX_SOCKETS
+#define POSIX_MAX_SOCKETS 32
+#endif
+
+class PosixNetworkInterface;
+
+/** PosixSocket class.
+    This is a SocketInterface over a BSD socket of the host, so that code written
+    against the NetworkSocketAPI can run and be profiled on a Linux machine.
+ */
+class PosixSocket : public SocketInterface
+{
+public:
+    PosixSocket();
+    PosixSocket(uint32_t handle, PosixNetworkInterface &interface, socket_protocol_t type, int fd = -1);
+    virtual const char *getHostByName(const char *name) const;
+    virtual void setAddress(const char* addr);
+    virtual void setPort(uint16_t port);
+    virtual void setAddressPort(const char* addr, uint16_t port);
+    virtual const char *getAddress(void) const;
+    virtual uint16_t getPort(void) const;
+    virtual int32_t bind(uint16_t port);
+    virtual int32_t listen(uint32_t backlog = 1);
+    virtual SocketInterface *accept(uint32_t timeout_ms = 15000);
+    virtual int32_t open();
+    virtual int32_t send(const void *data, uint32_t amount, uint32_t timeout_ms = 15000);
+    virtual uint32_t recv(void *data, uint32_t amount, uint32_t timeout_ms = 15000);
+    virtual int32_t sendTo(const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms = 15000);
+    virtual uint32_t recvFrom(char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms = 15000);
+    virtual int32_t close() const;
+    virtual uint32_t getHandle() const;
+
+    int getFD() const;
+    void setFD(int fd);
+    socket_protocol_t getType() const;
+
+protected:
+    int _fd;
+    PosixNetworkInterface* _interface;
+};
+
+/** PosixNetworkInterface class.
+    This is an interface to the network of the host through its BSD sockets.
+    The host is already connected, so init and connect only check that it has an
+    address, and the AP given to connect is ignored.
+ */
+class PosixNetworkInterface : public WiFiInterface
+{
+public:
+    PosixNetworkInterface();
+    virtual int32_t init(void);
+    virtual int32_t init(const char *ip, const char *mask, const char *gateway);
+    virtual int32_t connect(uint32_t timeout_ms = 15000);
+    virtual int32_t connect(const char *ap, const char *pass_phrase = 0, wifi_security_t security = WI_NONE, uint32_t timeout_ms = 15000);
+    virtual int32_t disconnect(void);
+    virtual char *getIPAddress(void);
+    virtual char *getGateway(void) const;
+    virtual char *getNetworkMask(void) const;
+    virtual char *getMACAddress(void) const;
+    virtual int32_t isConnected(void);
+    virtual SocketInterface *allocateSocket(socket_protocol_t socketProtocol);
+    virtual int deallocateSocket(SocketInterface *socket);
+    virtual int32_t poll(socket_poll_t *fds, uint32_t count, uint32_t timeout_ms = 15000);
+    void getHostByName(const char *name, char* hostIP);
+
+private:
+    friend class PosixSocket;
+
+    /** Close the file descriptor of a socket, the socket stays allocated */
+    int32_t closeSocket(const PosixSocket *socket);
+
+    /** Allocate a socket for an accepted connection */
+    SocketInterface *acceptSocket(PosixSocket *socket, uint32_t timeout_ms);
+
+    /** Take a free slot for a socket, NULL if all slots are used */
+    PosixSocket *allocateSlot(socket_protocol_t socketProtocol, int fd);
+
+    /** Look up an allocated socket by handle, NULL if the handle is stale */
+    PosixSocket *findSocket(uint32_t handle);
+
+    /** Read the addresses of the host into the cached strings */
+    bool refreshStatus(void);
+
+    static const int numSlots = POSIX_MAX_SOCKETS;
+
+    /** Socket slots, handles are allocated so that handle % numSlots is the slot */
+    PosixSocket socketSlots[numSlots];
+    /** Handle of the socket in each slot, freeSlot if unused */
+    static const uint32_t freeSlot = 0xFFFFFFFF;
+    uint32_t slotHandle[numSlots];
+    char ip[16];
+    char gateway[16];
+    char netmask[16];
+    char mac[18];
+};
+
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __unix__
+
+#include "PosixSockets.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+// Same values as socket_poll_event_t, which cannot be included here
+#define POSIX_POLLIN    0x1
+#define POSIX_POLLOUT   0x2
+#define POSIX_POLLHUP   0x4
+
+static uint32_t elapsed_ms(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+}
+
+// Wait for a single event, returns false on timeout or error
+static bool wait_for(int fd, short event, uint32_t timeout_ms)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = event;
+    pfd.revents = 0;
+    int ret;
+    do {
+        ret = poll(&pfd, 1, (int)timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0;
+}
+
+int posix_socket(bool udp)
+{
+    int fd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (!udp) {
+        //Small writes go out at once, like the ESP8266 sends each CIPSEND
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+int posix_connect(int fd, const char *addr, uint16_t port)
+{
+    if (addr == NULL) {
+        return -1;
+    }
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    if (inet_pton(AF_INET, addr, &sin.sin_addr) != 1) {
+        char ip[16];
+        if (posix_gethostbyname(addr, ip) < 0 || inet_pton(AF_INET, ip, &sin.sin_addr) != 1) {
+            return -1;
+        }
+    }
+    if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int posix_bind(int fd, uint16_t port)
+{
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int posix_listen(int fd, int backlog)
+{
+    return (listen(fd, backlog) < 0) ? -1 : 0;
+}
+
+int posix_accept(int fd, uint32_t timeout_ms)
+{
+    if (!wait_for(fd, POLLIN, timeout_ms)) {
+        return -1;
+    }
+    int client = accept(fd, NULL, NULL);
+    return (client < 0) ? -1 : client;
+}
+
+int posix_send(int fd, const void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    const char *p = (const char *)data;
+    while (amount > 0) {
+        uint32_t elapsed = elapsed_ms(start);
+        if (elapsed >= timeout_ms || !wait_for(fd, POLLOUT, timeout_ms - elapsed)) {
+            return -1;
+        }
+        ssize_t sent = send(fd, p, amount, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        p += sent;
+        amount -= sent;
+    }
+    return 0;
+}
+
+uint32_t posix_recv(int fd, void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    if (!wait_for(fd, POLLIN, timeout_ms)) {
+        return 0;
+    }
+    ssize_t received = recv(fd, data, amount, 0);
+    return (received < 0) ? 0 : (uint32_t)received;
+}
+
+int posix_sendto(int fd, const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    if (addr == NULL || inet_pton(AF_INET, addr, &sin.sin_addr) != 1) {
+        return -1;
+    }
+    if (!wait_for(fd, POLLOUT, timeout_ms)) {
+        return -1;
+    }
+    ssize_t sent = sendto(fd, data, amount, MSG_NOSIGNAL, (struct sockaddr *)&sin, sizeof(sin));
+    return (sent == (ssize_t)amount) ? 0 : -1;
+}
+
+uint32_t posix_recvfrom(int fd, char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms)
+{
+    addr[0] = 0;
+    *port = 0;
+    if (!wait_for(fd, POLLIN, timeout_ms)) {
+        return 0;
+    }
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+    ssize_t received = recvfrom(fd, data, amount, 0, (struct sockaddr *)&sin, &len);
+    if (received < 0) {
+        return 0;
+    }
+    inet_ntop(AF_INET, &sin.sin_addr, addr, 16);
+    *port = ntohs(sin.sin_port);
+    return (uint32_t)received;
+}
+
+void posix_close(int fd)
+{
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int posix_poll(const int *fds, const uint8_t *events, uint8_t *revents, uint32_t count, uint32_t timeout_ms)
+{
+    struct pollfd *pfds = new struct pollfd[count];
+    for (uint32_t i = 0; i < count; i++) {
+        pfds[i].fd = fds[i];
+        pfds[i].events = ((events[i] & POSIX_POLLIN) ? POLLIN : 0) | ((events[i] & POSIX_POLLOUT) ? POLLOUT : 0);
+        pfds[i].revents = 0;
+    }
+    int ret;
+    do {
+        ret = poll(pfds, count, (int)timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        delete[] pfds;
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        revents[i] = ((pfds[i].revents & POLLIN) ? POSIX_POLLIN : 0)
+                   | ((pfds[i].revents & POLLOUT) ? POSIX_POLLOUT : 0)
+                   | ((pfds[i].revents & (POLLHUP | POLLERR)) ? POSIX_POLLHUP : 0);
+    }
+    delete[] pfds;
+    return ret;
+}
+
+int posix_gethostbyname(const char *name, char *ip)
+{
+    struct addrinfo hints;
+    struct addrinfo *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(name, NULL, &hints, &res) != 0) {
+        return -1;
+    }
+    struct sockaddr_in *sin = (struct sockaddr_in *)res->ai_addr;
+    inet_ntop(AF_INET, &sin->sin_addr, ip, 16);
+    freeaddrinfo(res);
+    return 0;
+}
+
+int posix_interface_info(char *ip, char *netmask, char *gateway, char *mac)
+{
+    struct ifaddrs *ifs;
+    if (getifaddrs(&ifs) < 0) {
+        return -1;
+    }
+    struct ifaddrs *found = NULL;
+    for (struct ifaddrs *i = ifs; i; i = i->ifa_next) {
+        if (i->ifa_addr && i->ifa_addr->sa_family == AF_INET &&
+            (i->ifa_flags & IFF_UP) && !(i->ifa_flags & IFF_LOOPBACK)) {
+            found = i;
+            break;
+        }
+    }
+    if (found == NULL) {
+        freeifaddrs(ifs);
+        return -1;
+    }
+    inet_ntop(AF_INET, &((struct sockaddr_in *)found->ifa_addr)->sin_addr, ip, 16);
+    inet_ntop(AF_INET, &((struct sockaddr_in *)found->ifa_netmask)->sin_addr, netmask, 16);
+
+    //The default route of the interface, from the kernel routing table
+    gateway[0] = 0;
+    FILE *route = fopen("/proc/net/route", "r");
+    if (route) {
+        char line[256];
+        char name[IFNAMSIZ];
+        unsigned int dest;
+        unsigned int gw;
+        while (fgets(line, sizeof(line), route)) {
+            if (sscanf(line, "%15s %x %x", name, &dest, &gw) == 3 &&
+                dest == 0 && strcmp(name, found->ifa_name) == 0) {
+                struct in_addr addr;
+                addr.s_addr = gw;
+                inet_ntop(AF_INET, &addr, gateway, 16);
+                break;
+            }
+        }
+        fclose(route);
+    }
+
+    mac[0] = 0;
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/address", found->ifa_name);
+    FILE *address = fopen(path, "r");
+    if (address) {
+        if (fscanf(address, "%17s", mac) != 1) {
+            mac[0] = 0;
+        }
+        fclose(address);
+    }
+
+    freeifaddrs(ifs);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,105 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef POSIXSOCKETS_H
+#define POSIXSOCKETS_H
+
+#ifdef __unix__
+
+#include "stdint.h"
+
+/* Thin wrappers around the BSD socket calls.
+ * SocketInterface.h and <sys/socket.h> both declare SOCK_STREAM and friends,
+ * so the system headers are only included by PosixSockets.cpp.
+ * File descriptors are returned as is, -1 on failure.
+ */
+
+/** Create a socket
+    @param udp true for a UDP socket, false for TCP
+    @returns the file descriptor, -1 on failure
+ */
+int posix_socket(bool udp);
+
+/** Connect a socket, for UDP this sets where send() goes and recv() comes from
+    @param addr host name or IP address
+    @param port remote port
+    @returns 0 on success, -1 on failure
+ */
+int posix_connect(int fd, const char *addr, uint16_t port);
+
+/** Bind a socket to a local port on all addresses */
+int posix_bind(int fd, uint16_t port);
+
+/** Start listening for connections */
+int posix_listen(int fd, int backlog);
+
+/** Wait for an incoming connection
+    @returns the file descriptor of the connection, -1 on failure or timeout
+ */
+int posix_accept(int fd, uint32_t timeout_ms);
+
+/** Send all of a buffer
+    @returns 0 on success, -1 on failure or timeout
+ */
+int posix_send(int fd, const void *data, uint32_t amount, uint32_t timeout_ms);
+
+/** Receive what is available, waiting for at most timeout_ms for the first byte
+    @returns the number of bytes received, 0 on timeout or when closed
+ */
+uint32_t posix_recv(int fd, void *data, uint32_t amount, uint32_t timeout_ms);
+
+/** Send a datagram to an IP address and port
+    @returns 0 on success, -1 on failure or timeout
+ */
+int posix_sendto(int fd, const char *addr, uint16_t port, const void *data, uint32_t amount, uint32_t timeout_ms);
+
+/** Receive a datagram, waiting for at most timeout_ms
+    @param addr receives the IP address of the sender, 16 bytes
+    @param port receives the port of the sender
+    @returns the number of bytes received, 0 on timeout
+ */
+uint32_t posix_recvfrom(int fd, char *addr, uint16_t *port, void *data, uint32_t amount, uint32_t timeout_ms);
+
+/** Close a socket */
+void posix_close(int fd);
+
+/** Wait for events on a set of sockets
+    @param fds file descriptors to poll
+    @param events requested events per socket, as socket_poll_event_t flags
+    @param revents returned events per socket, as socket_poll_event_t flags
+    @param count number of sockets
+    @returns the number of sockets with events, 0 on timeout, -1 on failure
+ */
+int posix_poll(const int *fds, const uint8_t *events, uint8_t *revents, uint32_t count, uint32_t timeout_ms);
+
+/** Resolve a host name with the resolver of the host
+    @param ip receives the IPv4 address as a string, 16 bytes
+    @returns 0 on success, -1 on failure
+ */
+int posix_gethostbyname(const char *name, char *ip);
+
+/** Get the addresses of the first interface that is up and not loopback
+    @param ip receives the IPv4 address, 16 bytes
+    @param netmask receives the network mask, 16 bytes
+    @param gateway receives the default gateway, 16 bytes, empty if there is none
+    @param mac receives the MAC address, 18 bytes, empty if unknown
+    @returns 0 on success, -1 if there is no such interface
+ */
+int posix_interface_info(char *ip, char *netmask, char *gateway, char *mac);
+
+#endif
+
+#endif
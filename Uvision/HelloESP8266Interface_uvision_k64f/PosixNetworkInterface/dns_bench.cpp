@@ -0,0 +1,235 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark of DnsQuery on the host. A codec lookup is one query encoded
+// by buildQuery and its answer of three records decoded by parseAnswers.
+// Then a batch of 50 names is resolved over the loopback interface, one
+// name at a time and pipelined by DnsQuery::lookup, from a server thread
+// that answers each query after a fixed delay. Build and run in the
+// project directory with
+//
+//   g++ -O2 -pthread -INetworkSocketAPI -IDnsQuery -IPosixNetworkInterface PosixNetworkInterface/Posix*.cpp PosixNetworkInterface/dns_bench.cpp DnsQuery/*.cpp -o dns_bench
+//   ./dns_bench [lookups] [delay_ms]
+
+#ifdef __unix__
+
+#include "PosixNetworkInterface.h"
+#include "PosixSockets.h"
+#include "DnsQuery.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+/* Port of the server thread on the loopback interface */
+#ifndef DNS_BENCH_PORT
+#define DNS_BENCH_PORT 15354
+#endif
+
+/* Names in the batch resolved serially and pipelined */
+#define BATCH_NAMES 50
+
+static const char *const names[] = {
+    "mbed.org", "developer.mbed.org", "google.com", "www.arm.com",
+    "a.b.c.d.e.f.example.com", "ntp.pool.org", "api.github.com", "x.io"
+};
+static const int nameCount = sizeof(names) / sizeof(names[0]);
+
+// Answer to a query: the question echoed and three A records pointing at it
+
+static int answer(uint8_t *packet, int len)
+{
+    packet[2] |= 0x80;
+    packet[3] = 0x80;
+    packet[7] = 3;
+    for (int i = 0; i < 3; i++) {
+        static const uint8_t record[] = {0xC0, 12, 0, DNS_TYPE_A, 0, 1, 0, 0, 0x0E, 0x10, 0, 4, 10, 0, 0, 1};
+        memcpy(packet + len, record, sizeof(record));
+        packet[len + 15] = i + 1;
+        len += sizeof(record);
+    }
+    return len;
+}
+
+static double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static uint32_t clock_us(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_usec);
+}
+
+// DNS server thread, each answer is sent delay_ms after its query arrived,
+// queries in flight together are answered together like by a real server
+
+static int serverFD = -1;
+static volatile bool serverStop = false;
+static uint32_t serverDelay = 0;
+
+static void *serve(void *)
+{
+    struct {
+        uint8_t packet[DNS_MAX_PACKET];
+        int len;
+        char from[16];
+        uint16_t port;
+        uint32_t due;
+    } queue[2 * DNS_MAX_OUTSTANDING];
+    const int size = sizeof(queue) / sizeof(queue[0]);
+    int waiting = 0;
+
+    while (!serverStop) {
+        if (waiting < size) {
+            int len = posix_recvfrom(serverFD, queue[waiting].from, &queue[waiting].port,
+                                     queue[waiting].packet, DNS_MAX_PACKET - 48, 1);
+            if (len >= 12) {
+                queue[waiting].len = answer(queue[waiting].packet, len);
+                queue[waiting].due = clock_us() + serverDelay;
+                waiting++;
+            }
+        }
+        for (int i = 0; i < waiting; i++) {
+            if ((int32_t)(clock_us() - queue[i].due) < 0) {
+                continue;
+            }
+            posix_sendto(serverFD, queue[i].from, queue[i].port, queue[i].packet, queue[i].len, 100);
+            queue[i--] = queue[--waiting];
+        }
+    }
+    return NULL;
+}
+
+// Resolve the batch one name after the other, or all in one call
+
+static double batch(PosixNetworkInterface &net, bool pipelined, int *resolved)
+{
+    static char hostnames[BATCH_NAMES][32];
+    dns_addr_t addrs[BATCH_NAMES][4];
+    dns_lookup_t lookups[BATCH_NAMES];
+    for (int i = 0; i < BATCH_NAMES; i++) {
+        snprintf(hostnames[i], sizeof(hostnames[i]), "host%d.example.com", i);
+        lookups[i].hostname = hostnames[i];
+        lookups[i].ipv6 = false;
+        lookups[i].addrs = addrs[i];
+        lookups[i].count = 4;
+    }
+
+    SocketInterface *sock = net.allocateSocket(SOCK_UDP);
+    sock->setAddressPort("127.0.0.1", DNS_BENCH_PORT);
+    sock->open();
+    uint32_t start = clock_us();
+    *resolved = 0;
+    if (pipelined) {
+        *resolved = DnsQuery::lookup(sock, lookups, BATCH_NAMES, 10000);
+    } else {
+        for (int i = 0; i < BATCH_NAMES; i++) {
+            *resolved += DnsQuery::lookup(sock, &lookups[i], 1, 10000);
+        }
+    }
+    uint32_t elapsed = clock_us() - start;
+    net.deallocateSocket(sock);
+    return elapsed / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+    long lookups = (argc > 1) ? atol(argv[1]) : 2000000;
+    int delay = (argc > 2) ? atoi(argv[2]) : 5;
+    if (lookups <= 0 || delay < 0) {
+        printf("usage: %s [lookups] [delay_ms]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t packets[nameCount][DNS_MAX_PACKET];
+    int lengths[nameCount];
+    for (int i = 0; i < nameCount; i++) {
+        lengths[i] = answer(packets[i], DnsQuery::buildQuery(packets[i], DNS_MAX_PACKET, 0x1234, names[i]));
+    }
+
+    uint8_t query[DNS_MAX_PACKET];
+    dns_addr_t addrs[4];
+    long sum = 0;
+
+    clock_t start = clock();
+    for (long i = 0; i < lookups; i++) {
+        sum += DnsQuery::buildQuery(query, sizeof(query), (uint16_t)i, names[i % nameCount]);
+    }
+    double build = seconds(start);
+
+    start = clock();
+    for (long i = 0; i < lookups; i++) {
+        int n = i % nameCount;
+        sum += DnsQuery::parseAnswers(packets[n], lengths[n], 0x1234, addrs, 4);
+    }
+    double parse = seconds(start);
+
+    //Both halves of a lookup, the answer carries the ID of the query
+    start = clock();
+    for (long i = 0; i < lookups; i++) {
+        int n = i % nameCount;
+        uint16_t id = (uint16_t)i;
+        int len = DnsQuery::buildQuery(query, sizeof(query), id, names[n]);
+        memcpy(query + len, packets[n] + len, lengths[n] - len);
+        query[2] |= 0x80;
+        query[3] = 0x80;
+        query[7] = 3;
+        sum += DnsQuery::parseAnswers(query, lengths[n], id, addrs, 4);
+    }
+    double both = seconds(start);
+
+    printf("%-10s %10s %14s\n", "codec", "count", "per second");
+    printf("%-10s %10ld %14.0f\n", "build", lookups, build > 0 ? lookups / build : 0.0);
+    printf("%-10s %10ld %14.0f\n", "parse", lookups, parse > 0 ? lookups / parse : 0.0);
+    printf("%-10s %10ld %14.0f\n", "lookup", lookups, both > 0 ? lookups / both : 0.0);
+    //Keeps the loops from being optimized away
+    if (sum == 0) {
+        return 1;
+    }
+
+    //Loopback needs no connection, so init and connect may fail on a host without one
+    PosixNetworkInterface net;
+    net.init();
+    net.connect();
+    pthread_t server;
+    serverDelay = delay * 1000;
+    serverFD = posix_socket(true);
+    if (serverFD < 0 || posix_bind(serverFD, DNS_BENCH_PORT) < 0 ||
+        pthread_create(&server, NULL, serve, NULL) != 0) {
+        printf("cannot bind the DNS server to port %d\n", DNS_BENCH_PORT);
+        return 1;
+    }
+
+    int serial, pipelined;
+    double serialMs = batch(net, false, &serial);
+    double pipelinedMs = batch(net, true, &pipelined);
+    serverStop = true;
+    pthread_join(server, NULL);
+    posix_close(serverFD);
+
+    printf("\n%d names, answers after %d ms, %d queries in flight\n", BATCH_NAMES, delay, DNS_MAX_OUTSTANDING);
+    printf("%-10s %10s %14s\n", "batch", "resolved", "ms");
+    printf("%-10s %10d %14.1f\n", "serial", serial, serialMs);
+    printf("%-10s %10d %14.1f\n", "pipelined", pipelined, pipelinedMs);
+    return (serial == BATCH_NAMES && pipelined == BATCH_NAMES) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,212 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Fuzz harness of the DNS packet codec of DnsQuery. Answers built from
+// valid queries are mutated and handed to the decoders in a buffer of
+// exactly their length, so the sanitizers catch any read past the end.
+// Build and run in the project directory with
+//
+//   g++ -g -O1 -fsanitize=address,undefined -INetworkSocketAPI -IDnsQuery PosixNetworkInterface/dns_fuzz.cpp DnsQuery/DnsQuery.cpp -o dns_fuzz
+//   ./dns_fuzz [iterations] [seed]
+//
+// With -DDNS_FUZZ_LIBFUZZER and -fsanitize=fuzzer it is a libFuzzer target
+// instead. It prints each broken invariant and exits with 1 if there was one.
+
+#ifdef __unix__
+
+#include "DnsQuery.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// Run every decoder over one message
+
+static void decode(const uint8_t *data, int len)
+{
+    //A copy of exactly len bytes, the sanitizers see reads past it
+    uint8_t *resp = new uint8_t[len ? len : 1];
+    memcpy(resp, data, len);
+    uint16_t id = (len >= 2) ? ((resp[0] << 8) | resp[1]) : 0;
+
+    int m = DnsQuery::messageLength(resp, len);
+    CHECK(m <= len && m <= DNS_MAX_PACKET);
+
+    dns_addr_t addrs[4];
+    int found = DnsQuery::parseAnswers(resp, len, id, addrs, 4);
+    CHECK(found >= -1 && found <= 4);
+    for (int i = 0; i < found; i++) {
+        CHECK(addrs[i].version == 4 || addrs[i].version == 6);
+        CHECK((addrs[i].ttl & 0x80000000) == 0);
+        char str[40];
+        DnsQuery::addressToString(&addrs[i], str);
+        CHECK(strlen(str) < sizeof(str));
+    }
+
+    char ip[16];
+    uint32_t ttl;
+    if (DnsQuery::parseResponse(resp, len, id, ip, &ttl)) {
+        CHECK(strlen(ip) < sizeof(ip));
+    }
+    delete[] resp;
+}
+
+// Encode a name into a buffer of exactly size bytes
+
+static void encode(const char *name, int size)
+{
+    uint8_t *packet = new uint8_t[size ? size : 1];
+    int len = DnsQuery::buildQuery(packet, size, 0x1234, name, DNS_TYPE_A);
+    CHECK(len <= size);
+    if (len > 0) {
+        //A query is a whole message with one question
+        CHECK(DnsQuery::messageLength(packet, len) == len);
+    }
+    delete[] packet;
+}
+
+#ifdef DNS_FUZZ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size > 2 * DNS_MAX_PACKET) {
+        return 0;
+    }
+    decode(data, (int)size);
+    return 0;
+}
+
+#else
+
+static const char *const names[] = {
+    "mbed.org", "a.b.c.d.e.f.example.com", "x", "developer.mbed.org.",
+    "0123456789012345678901234567890123456789012345678901234567890123.org"
+};
+
+// Answer to a query for name, with an A, an AAAA and a CNAME record
+
+static int seed(uint8_t *packet, int size, const char *name)
+{
+    int len = DnsQuery::buildQuery(packet, size, rand() & 0xFFFF, name, DNS_TYPE_A);
+    if (len < 0) {
+        return 0;
+    }
+    static const uint8_t records[] = {
+        0xC0, 12, 0, DNS_TYPE_A, 0, 1, 0, 0, 0x0E, 0x10, 0, 4, 10, 0, 0, 1,
+        0xC0, 12, 0, DNS_TYPE_AAAA, 0, 1, 0, 0, 0, 60, 0, 16,
+        0x20, 0x01, 0x0D, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+        0xC0, 12, 0, 5, 0, 1, 0, 0, 0, 60, 0, 4, 1, 'a', 0xC0, 12,
+    };
+    if (len + (int)sizeof(records) > size) {
+        return len;
+    }
+    memcpy(packet + len, records, sizeof(records));
+    packet[2] |= 0x80;
+    packet[7] = 3;
+    return len + sizeof(records);
+}
+
+// Change a few bytes, the length or the counts of a message
+
+static int mutate(uint8_t *packet, int len, int size)
+{
+    int changes = 1 + rand() % 4;
+    for (int i = 0; i < changes; i++) {
+        int pos = (len > 0) ? rand() % len : 0;
+        switch (rand() % 6) {
+            case 0:
+                packet[pos] ^= 1 << (rand() % 8);
+                break;
+            case 1:
+                packet[pos] = rand();
+                break;
+            case 2:
+                //A compression pointer to anywhere
+                if (pos + 1 < len) {
+                    packet[pos] = 0xC0 | (rand() & 0x3F);
+                    packet[pos + 1] = rand();
+                }
+                break;
+            case 3:
+                len = rand() % (len + 1);
+                break;
+            case 4:
+                if (len < size) {
+                    packet[len++] = rand();
+                }
+                break;
+            case 5:
+                //Counts in the header, up to the largest
+                if (len >= 12) {
+                    pos = 4 + rand() % 8;
+                    packet[pos] = (rand() % 8 == 0) ? 0xFF : rand() % 4;
+                }
+                break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+    unsigned int start = (argc > 2) ? atoi(argv[2]) : 1;
+    const int count = sizeof(names) / sizeof(names[0]);
+
+    if (iterations <= 0) {
+        printf("usage: %s [iterations] [seed]\n", argv[0]);
+        return 1;
+    }
+    srand(start);
+
+    //Names of every length around the limits, with and without valid labels
+    char name[300];
+    for (int n = 0; n < (int)sizeof(name) - 1; n++) {
+        for (int i = 0; i < n; i++) {
+            name[i] = (i % 64 == 63) ? '.' : 'a' + i % 26;
+        }
+        name[n] = 0;
+        encode(name, DNS_MAX_PACKET);
+        encode(name, 12 + n + 6);
+        encode(name, 12 + n + 5);
+    }
+
+    uint8_t packet[2 * DNS_MAX_PACKET];
+    int len = 0;
+    for (long i = 0; i < iterations && failures == 0; i++) {
+        //Mutations pile up for a while, then start over from a valid answer
+        if (i % 64 == 0) {
+            len = seed(packet, sizeof(packet), names[rand() % count]);
+        }
+        len = mutate(packet, len, sizeof(packet));
+        decode(packet, len);
+    }
+
+    printf("%ld messages: %s\n", iterations, failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,268 @@
+/* PosixNetworkInterface Example
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host check of the sockets, DnsQuery and DnsResolver over the loopback
+// interface. A thread plays the DNS server, so nothing leaves the host.
+// It also prints the latency of the resolver with a cold and a warm cache.
+// Build and run in the project directory with
+//
+//   g++ -g -fsanitize=address -pthread -DDNS_RESOLVER_PORT=15353 -INetworkSocketAPI -IDnsQuery -IPosixNetworkInterface PosixNetworkInterface/Posix*.cpp PosixNetworkInterface/posix_check.cpp DnsQuery/*.cpp -o posix_check
+//   ./posix_check
+//
+// It prints each failed check and exits with 1 if there was one.
+
+#ifdef __unix__
+
+#include "PosixNetworkInterface.h"
+#include "PosixSockets.h"
+#include "DnsResolver.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// DNS server thread, answers every A query with the same three records
+
+static const uint8_t answerAddrs[3][4] = {{10, 0, 0, 1}, {10, 0, 0, 2}, {10, 0, 0, 3}};
+static const uint32_t answerTTLs[3] = {300, 60, 600};
+
+static int serverFD = -1;
+static volatile bool serverStop = false;
+static volatile int serverQueries = 0;
+
+static void *serve(void *)
+{
+    uint8_t packet[DNS_MAX_PACKET];
+    while (!serverStop) {
+        //A short timeout lets the thread see the stop flag
+        char from[16];
+        uint16_t port;
+        int len = posix_recvfrom(serverFD, from, &port, packet, sizeof(packet), 100);
+        if (len < 12) {
+            continue;
+        }
+        serverQueries++;
+        //The question is echoed, the answers point back at its name
+        packet[2] = 0x81;
+        packet[3] = 0x80;
+        packet[6] = 0;
+        packet[7] = 3;
+        for (int i = 0; i < 3 && len + 16 <= (int)sizeof(packet); i++) {
+            uint8_t *p = packet + len;
+            p[0] = 0xC0;
+            p[1] = 12;
+            p[2] = 0;
+            p[3] = DNS_TYPE_A;
+            p[4] = 0;
+            p[5] = 1;
+            p[6] = answerTTLs[i] >> 24;
+            p[7] = answerTTLs[i] >> 16;
+            p[8] = answerTTLs[i] >> 8;
+            p[9] = answerTTLs[i];
+            p[10] = 0;
+            p[11] = 4;
+            memcpy(p + 12, answerAddrs[i], 4);
+            len += 16;
+        }
+        posix_sendto(serverFD, from, port, packet, len, 100);
+    }
+    return NULL;
+}
+
+static bool startServer(pthread_t *thread)
+{
+    serverFD = posix_socket(true);
+    if (serverFD < 0) {
+        return false;
+    }
+    if (posix_bind(serverFD, DNS_RESOLVER_PORT) < 0) {
+        posix_close(serverFD);
+        return false;
+    }
+    return pthread_create(thread, NULL, serve, NULL) == 0;
+}
+
+static uint32_t clock_us(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_usec);
+}
+
+static bool sameAddresses(const dns_addr_t *addrs, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (addrs[i].version != 4 || memcmp(addrs[i].addr, answerAddrs[i], 4) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Invalid arguments are refused instead of dereferenced
+
+static void checkArguments(PosixNetworkInterface &net)
+{
+    CHECK(net.deallocateSocket(NULL) == -1);
+
+    SocketInterface *sock = net.allocateSocket(SOCK_UDP);
+    CHECK(sock != NULL);
+    socket_poll_t fds[2] = {{sock, SOCK_POLLIN, 0}, {NULL, SOCK_POLLIN, 0}};
+    CHECK(net.poll(fds, 2, 0) < 0);
+    CHECK(net.deallocateSocket(sock) == 0);
+    CHECK(net.deallocateSocket(sock) == -1);
+}
+
+// A TCP connection over the loopback interface, seen through poll
+
+static void checkTCP(PosixNetworkInterface &net)
+{
+    SocketInterface *server = net.allocateSocket(SOCK_TCP);
+    SocketInterface *client = net.allocateSocket(SOCK_TCP);
+    CHECK(server->bind(DNS_RESOLVER_PORT) == 0);
+    CHECK(server->listen(1) == 0);
+    client->setAddressPort("127.0.0.1", DNS_RESOLVER_PORT);
+    CHECK(client->open() == 0);
+
+    socket_poll_t fds = {server, SOCK_POLLIN, 0};
+    CHECK(net.poll(&fds, 1, 1000) == 1);
+    SocketInterface *conn = server->accept(1000);
+    CHECK(conn != NULL);
+    if (conn != NULL) {
+        char data[8] = {0};
+        CHECK(client->send("hello", 5) == 0);
+        CHECK(conn->recv(data, sizeof(data), 1000) == 5);
+        CHECK(strcmp(data, "hello") == 0);
+        net.deallocateSocket(conn);
+    }
+    net.deallocateSocket(client);
+    net.deallocateSocket(server);
+}
+
+// Pipelined queries of DnsQuery and the resolver with its cache
+
+static void checkDNS(PosixNetworkInterface &net)
+{
+    dns_addr_t addrs[2][4];
+    dns_lookup_t lookups[2] = {
+        {"mbed.org", false, addrs[0], 4, 0},
+        {"example.com", false, addrs[1], 4, 0},
+    };
+    SocketInterface *sock = net.allocateSocket(SOCK_UDP);
+    sock->setAddressPort("127.0.0.1", DNS_RESOLVER_PORT);
+    CHECK(sock->open() == 0);
+    CHECK(DnsQuery::lookup(sock, lookups, 2, 2000) == 2);
+    CHECK(lookups[0].found == 3 && sameAddresses(addrs[0], 3));
+    CHECK(lookups[1].found == 3 && sameAddresses(addrs[1], 3));
+    net.deallocateSocket(sock);
+
+    static const char *servers[] = {"127.0.0.1"};
+    DnsResolver resolver(net);
+    CHECK(resolver.setServers(servers, 1));
+    dns_addr_t found[4];
+    CHECK(resolver.getHostByName("mbed.org", found, 4, 2000) == 3);
+    CHECK(sameAddresses(found, 3));
+
+    //The second time the answer comes from the cache, the shortest TTL decides
+    int queries = serverQueries;
+    char ip[16];
+    CHECK(resolver.getHostByName("mbed.org", ip, 2000));
+    CHECK(strcmp(ip, "10.0.0.1") == 0);
+    CHECK(resolver.lookup("mbed.org", found, 2) == 2);
+    CHECK(found[1].ttl == 60);
+    CHECK(serverQueries == queries);
+
+    resolver.store("example.com", "192.168.1.10", 30);
+    CHECK(resolver.lookup("example.com", ip));
+    CHECK(strcmp(ip, "192.168.1.10") == 0);
+    resolver.flushCache();
+    CHECK(!resolver.lookup("example.com", ip));
+}
+
+// Lookups with an empty cache go to the server, the same names again are
+// answered from the cache
+
+static void checkLatency(PosixNetworkInterface &net)
+{
+    static const char *servers[] = {"127.0.0.1"};
+    const int names = 8;
+    const int rounds = 100;
+    DnsResolver resolver(net);
+    CHECK(resolver.setServers(servers, 1));
+
+    char name[32];
+    dns_addr_t found[4];
+    uint32_t cold = 0;
+    uint32_t warm = 0;
+    int queries = serverQueries;
+    for (int r = 0; r < rounds; r++) {
+        resolver.flushCache();
+        uint32_t start = clock_us();
+        for (int i = 0; i < names; i++) {
+            snprintf(name, sizeof(name), "host%d.example.com", i);
+            CHECK(resolver.getHostByName(name, found, 4, 2000) == 3);
+        }
+        cold += clock_us() - start;
+        start = clock_us();
+        for (int i = 0; i < names; i++) {
+            snprintf(name, sizeof(name), "host%d.example.com", i);
+            CHECK(resolver.getHostByName(name, found, 4, 2000) == 3);
+        }
+        warm += clock_us() - start;
+    }
+    //Only the cold lookups reach the server
+    CHECK(serverQueries - queries == names * rounds);
+    CHECK(warm < cold);
+    printf("resolver lookup: cold %.1f us, warm %.2f us\n",
+           (double)cold / (names * rounds), (double)warm / (names * rounds));
+}
+
+int main(void)
+{
+    //Loopback needs no connection, so init and connect may fail on a host without one
+    PosixNetworkInterface net;
+    net.init();
+    net.connect();
+
+    pthread_t server;
+    if (!startServer(&server)) {
+        printf("cannot bind the DNS server to port %d\n", DNS_RESOLVER_PORT);
+        return 1;
+    }
+
+    checkArguments(net);
+    checkTCP(net);
+    checkDNS(net);
+    checkLatency(net);
+
+    serverStop = true;
+    pthread_join(server, NULL);
+    posix_close(serverFD);
+
+    printf("%s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
+
+#endif